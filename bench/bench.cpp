@@ -0,0 +1,249 @@
+// Microbenchmarks for the pipeline stages, run from the build directory:
+//   ./SpaceTravel_bench [filter] [--repetitions n] [--min-time seconds]
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../headers/FastNoise.h"
+#include "../headers/ObjLoader.h"
+#include "../headers/framebuffer.h"
+#include "../headers/mesh.h"
+#include "../headers/noise.h"
+#include "../headers/scene.h"
+#include "../headers/shaders.h"
+#include "../headers/stars.h"
+#include "../headers/triangle.h"
+#include "../headers/vertexbatch.h"
+#include "benchmark.h"
+
+#ifndef BENCH_MODEL_DIR
+#define BENCH_MODEL_DIR "../models"
+#endif
+#ifndef BENCH_SCENE_DIR
+#define BENCH_SCENE_DIR "../scenes"
+#endif
+
+constexpr int SHADER_GRID = 64; // Fragments per side of the patch every fragment shader shades
+constexpr int NOISE_SAMPLES = 1024;
+
+Uniforms benchUniforms()
+{
+    Uniforms uniforms;
+    uniforms.model = glm::mat4(1.0f);
+    uniforms.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    uniforms.projection = glm::perspective(glm::radians(45.0f), static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT, 0.1f, 100.0f);
+    uniforms.viewport = glm::scale(glm::mat4(1.0f), glm::vec3(SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f, 0.5f));
+    uniforms.viewport = glm::translate(uniforms.viewport, glm::vec3(1.0f, 1.0f, 0.5f));
+    return uniforms;
+}
+
+void benchVertexStage(const std::vector<glm::vec3> &vbo)
+{
+    Uniforms uniforms = benchUniforms();
+    size_t count = vbo.size() / 3;
+
+    std::vector<Vertex> transformed(count);
+    benchmark("vertexShader/sphere", count, [&]
+              {
+        for (size_t i = 0; i < count; ++i)
+        {
+            transformed[i] = vertexShader(vbo[3 * i], vbo[3 * i + 1], vbo[3 * i + 2], uniforms);
+        }
+        doNotOptimize(transformed.data()); });
+
+    VertexStream stream = makeVertexStream(vbo);
+    VertexTransform transform = makeVertexTransform(uniforms);
+    benchmark("transformVertices/sphere", count, [&]
+              {
+        transformVertices(stream, transform, transformed);
+        doNotOptimize(transformed.data()); });
+}
+
+// Screen-space right triangle with legs of the given length in pixels, centered on the screen
+void benchTriangle(int size)
+{
+    glm::vec3 origin(SCREEN_WIDTH / 2.0f - size / 2.0f, SCREEN_HEIGHT / 2.0f - size / 2.0f, 0.5f);
+    PackedNormal normal = packNormal(glm::vec3(0.0f, 0.0f, 1.0f));
+    Vertex a{origin, normal, glm::vec2(0.0f, 0.0f), glm::vec3(0.0f)};
+    Vertex b{origin + glm::vec3(size, 0.0f, 0.0f), normal, glm::vec2(1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)};
+    Vertex c{origin + glm::vec3(0.0f, size, 0.0f), normal, glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)};
+
+    size_t fragments = triangle(a, b, c).size();
+    for (bool needsPosition : {false, true})
+    {
+        std::string name = "triangle/" + std::to_string(size) + "px" + (needsPosition ? "/position" : "");
+        benchmark(name, fragments, [&]
+                  { doNotOptimize(triangle(a, b, c, needsPosition)); });
+    }
+}
+
+// Fragments covering the whole uv range with object positions on the unit sphere
+std::vector<Fragment> shaderPatch()
+{
+    std::vector<Fragment> fragments;
+    for (int y = 0; y < SHADER_GRID; ++y)
+    {
+        for (int x = 0; x < SHADER_GRID; ++x)
+        {
+            glm::vec2 uv((x + 0.5f) / SHADER_GRID, (y + 0.5f) / SHADER_GRID);
+            float longitude = uv.x * 2.0f * glm::pi<float>();
+            float latitude = (uv.y - 0.5f) * glm::pi<float>();
+
+            Fragment fragment{};
+            fragment.x = static_cast<uint16_t>(x);
+            fragment.y = static_cast<uint16_t>(y);
+            fragment.z = 0.5f;
+            fragment.intensity = 1.0f;
+            fragment.uv = uv;
+            fragment.footprint = 0.0f; // Every noise layer, the worst case
+            fragment.originalPos = glm::vec3(std::cos(latitude) * std::cos(longitude), std::sin(latitude), std::cos(latitude) * std::sin(longitude));
+            fragments.push_back(fragment);
+        }
+    }
+    return fragments;
+}
+
+void benchShaders()
+{
+    const std::vector<Fragment> patch = shaderPatch();
+    std::vector<Fragment> fragments(patch.size());
+
+    const std::pair<const char *, ShaderType> shaders[] = {
+        {"rocky", ROCKY}, {"gas", GAS}, {"sun", SUN}, {"earth", EARTH}, {"mars", MARS}, {"neptune", NEPTUNE}, {"star", STAR}};
+    for (const auto &[name, type] : shaders)
+    {
+        FragmentShader shader = selectShader(type);
+        benchmark(std::string("shader/") + name, patch.size(), [&]
+                  {
+            for (size_t i = 0; i < patch.size(); ++i)
+            {
+                Fragment fragment = patch[i];
+                fragments[i] = shader(fragment);
+            }
+            doNotOptimize(fragments.data()); });
+    }
+}
+
+void benchNoise()
+{
+    const std::pair<const char *, FastNoiseLite::NoiseType> types[] = {
+        {"OpenSimplex2", FastNoiseLite::NoiseType_OpenSimplex2},
+        {"OpenSimplex2S", FastNoiseLite::NoiseType_OpenSimplex2S},
+        {"Cellular", FastNoiseLite::NoiseType_Cellular},
+        {"Perlin", FastNoiseLite::NoiseType_Perlin},
+        {"ValueCubic", FastNoiseLite::NoiseType_ValueCubic},
+        {"Value", FastNoiseLite::NoiseType_Value}};
+
+    for (const auto &[name, type] : types)
+    {
+        FastNoiseLite noise;
+        noise.SetNoiseType(type);
+        benchmark(std::string("GetNoise2D/") + name, NOISE_SAMPLES, [&]
+                  {
+            float sum = 0.0f;
+            for (int i = 0; i < NOISE_SAMPLES; ++i)
+            {
+                sum += noise.GetNoise(i * 1.37f, i * 0.71f);
+            }
+            doNotOptimize(sum); });
+        benchmark(std::string("GetNoise3D/") + name, NOISE_SAMPLES, [&]
+                  {
+            float sum = 0.0f;
+            for (int i = 0; i < NOISE_SAMPLES; ++i)
+            {
+                sum += noise.GetNoise(i * 1.37f, i * 0.71f, i * 0.53f);
+            }
+            doNotOptimize(sum); });
+    }
+}
+
+void benchLoadOBJ(const std::string &model)
+{
+    std::string path = std::string(BENCH_MODEL_DIR) + "/" + model;
+    std::vector<glm::vec3> vertices, normals, texCoords;
+    std::vector<Face> faces;
+    if (!loadOBJ(path.c_str(), vertices, normals, texCoords, faces))
+    {
+        std::cerr << "Error: Failed to load " << path << std::endl;
+        return;
+    }
+
+    benchmark("loadOBJ/" + model, faces.size(), [&]
+              {
+        vertices.clear();
+        normals.clear();
+        texCoords.clear();
+        faces.clear();
+        loadOBJ(path.c_str(), vertices, normals, texCoords, faces);
+        doNotOptimize(faces.data()); });
+}
+
+// One gravity step of the 20k-body cluster on the shared worker pool, the whole frame budget is 16.7 ms.
+// The scene names its meshes relative to the working directory, so this runs from the build directory
+void benchNBody()
+{
+    std::string path = std::string(BENCH_SCENE_DIR) + "/cluster.scene";
+    Scene scene;
+    if (!loadScene(path, scene))
+    {
+        std::cerr << "Error: Failed to load " << path << std::endl;
+        return;
+    }
+
+    benchmark("nbody/cluster step", scene.gravity.count, [&]
+              { scene.gravity.step(); });
+}
+
+void benchFramebuffer()
+{
+    benchmark("renderStars", SCREEN_WIDTH * SCREEN_HEIGHT, []
+              {
+        renderStars(0, 0);
+        doNotOptimize(framebuffer.data()); });
+
+    // A software renderer on a memory surface, so no window or video subsystem is needed
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    if (!renderer)
+    {
+        std::cerr << "Error: Failed to create a software renderer: " << SDL_GetError() << std::endl;
+        SDL_FreeSurface(surface);
+        return;
+    }
+
+    benchmark("renderBuffer", SCREEN_WIDTH * SCREEN_HEIGHT, [&]
+              { renderBuffer(renderer); });
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+}
+
+int main(int argc, char *argv[])
+{
+    parseBenchmarkOptions(argc, argv);
+    setupNoise();
+
+    std::vector<glm::vec3> sphere = createVBO(std::string(BENCH_MODEL_DIR) + "/sphere.obj");
+    if (sphere.empty())
+    {
+        std::cerr << "Error: Failed to load " << BENCH_MODEL_DIR << "/sphere.obj" << std::endl;
+        return 1;
+    }
+
+    benchVertexStage(sphere);
+    for (int size : {4, 32, 256})
+    {
+        benchTriangle(size);
+    }
+    benchShaders();
+    benchNoise();
+    benchLoadOBJ("sphere.obj");
+    benchLoadOBJ("nave.obj");
+    benchNBody();
+    benchFramebuffer();
+
+    return 0;
+}
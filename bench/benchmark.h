@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Settings shared by every benchmark of a run, see parseBenchmarkOptions()
+struct BenchmarkOptions
+{
+    int repetitions = 10;      // Timed samples per benchmark
+    double minSeconds = 0.05;  // Each sample runs the body at least this long
+    std::string filter;        // Only benchmarks whose name contains this run
+};
+
+BenchmarkOptions benchmarkOptions;
+
+// Keeps the compiler from discarding a result that is never read
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void parseBenchmarkOptions(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--repetitions" && i + 1 < argc)
+        {
+            benchmarkOptions.repetitions = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--min-time" && i + 1 < argc)
+        {
+            benchmarkOptions.minSeconds = std::atof(argv[++i]);
+        }
+        else
+        {
+            benchmarkOptions.filter = arg;
+        }
+    }
+
+    std::printf("%-36s %10s %12s %12s %8s %14s\n", "benchmark", "iters", "ns/op", "min ns/op", "stddev", "items/s");
+}
+
+// Times body() and prints the median ns per call over the repetitions, with the spread and throughput.
+// itemsPerOp is how many items (vertices, fragments, pixels...) one call processes.
+template <typename Body>
+void benchmark(const std::string &name, double itemsPerOp, Body body)
+{
+    if (!benchmarkOptions.filter.empty() && name.find(benchmarkOptions.filter) == std::string::npos)
+    {
+        return;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto run = [&](uint64_t iterations)
+    {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            body();
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    // Warm up, then grow the iteration count until one sample is long enough to time reliably
+    uint64_t iterations = 1;
+    double seconds = run(iterations);
+    while (seconds < benchmarkOptions.minSeconds)
+    {
+        double scale = seconds > 0.0 ? benchmarkOptions.minSeconds / seconds * 1.2 : 10.0;
+        iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * std::min(scale, 10.0)));
+        seconds = run(iterations);
+    }
+
+    std::vector<double> samples(benchmarkOptions.repetitions);
+    for (double &sample : samples)
+    {
+        sample = run(iterations) * 1e9 / iterations;
+    }
+    std::sort(samples.begin(), samples.end());
+
+    double mean = 0.0;
+    for (double sample : samples)
+    {
+        mean += sample;
+    }
+    mean /= samples.size();
+    double variance = 0.0;
+    for (double sample : samples)
+    {
+        variance += (sample - mean) * (sample - mean);
+    }
+    double stddev = std::sqrt(variance / samples.size());
+
+    double median = samples[samples.size() / 2];
+    std::printf("%-36s %10llu %12.1f %12.1f %7.1f%% %14.4g\n", name.c_str(), static_cast<unsigned long long>(iterations),
+                median, samples.front(), 100.0 * stddev / mean, itemsPerOp * 1e9 / median);
+    std::fflush(stdout);
+}
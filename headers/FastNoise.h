@@ -394,6 +394,9 @@ public:
     }
 
 private:
+    // Compile-time specialized kernels in noisekernel.h call the per-type generators directly
+    friend struct NoiseKernelAccess;
+
     template <typename T>
     struct Arguments_must_be_floating_point_values;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Heap activity of one thread. Only counted when built with ENABLE_ALLOCATION_TRACKING,
+// which replaces the global operator new / delete (src/alloctracker.cpp).
+struct AllocationCounters
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;        // Requested by the allocations
+    int64_t liveBytes = 0;     // Allocated minus freed by this thread, negative if it frees other threads' memory
+    int64_t peakLiveBytes = 0; // Highest liveBytes since the innermost open AllocationScope began
+};
+
+inline thread_local AllocationCounters threadAllocations;
+
+#ifdef TRACK_ALLOCATIONS
+constexpr bool ALLOCATION_TRACKING = true;
+#else
+constexpr bool ALLOCATION_TRACKING = false;
+#endif
+
+// What a scope did to the calling thread's heap
+struct AllocationDelta
+{
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+    int64_t peakLiveBytes = 0; // Highest growth of live bytes over the scope's start
+
+    void add(const AllocationDelta &other)
+    {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        peakLiveBytes = std::max(peakLiveBytes, other.peakLiveBytes);
+    }
+};
+
+// Measures the calling thread's allocations between begin() and end(). Scopes may nest,
+// the enclosing scope still sees the peak reached inside.
+class AllocationScope
+{
+public:
+    void begin()
+    {
+        start = threadAllocations;
+        threadAllocations.peakLiveBytes = threadAllocations.liveBytes;
+    }
+
+    AllocationDelta end()
+    {
+        AllocationCounters &now = threadAllocations;
+        AllocationDelta delta;
+        delta.allocations = now.allocations - start.allocations;
+        delta.bytes = now.bytes - start.bytes;
+        delta.peakLiveBytes = now.peakLiveBytes - start.liveBytes;
+        now.peakLiveBytes = std::max(start.peakLiveBytes, now.peakLiveBytes);
+        return delta;
+    }
+
+private:
+    AllocationCounters start;
+};
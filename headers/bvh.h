@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+
+constexpr int BVH_LEAF_SIZE = 4;           // Instances per leaf
+constexpr float BVH_REBUILD_GROWTH = 2.0f; // Rebuild once refits have grown the root's surface area this much
+
+// Six planes (x, y, z, w) of the view volume, inside where dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+};
+
+// Planes extracted from projection * view (Gribb-Hartmann), OpenGL clip space
+Frustum makeFrustum(const glm::mat4 &viewProjection)
+{
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; ++r)
+    {
+        row[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    }
+
+    Frustum frustum;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        frustum.planes[2 * axis] = row[3] + row[axis];
+        frustum.planes[2 * axis + 1] = row[3] - row[axis];
+    }
+    return frustum;
+}
+
+// Bounding volume hierarchy over instance bounding spheres, for culling whole groups of instances
+// with one test. Built top-down with median splits, then refit bottom-up as the instances move;
+// it is rebuilt when the instance count changes or refits have let it degrade too far.
+class SceneBVH
+{
+public:
+    // spheres: center and radius per instance, a negative radius marks instances that are never culled
+    void update(const std::vector<glm::vec4> &spheres)
+    {
+        if (spheres.size() != instanceCount || nodes.empty())
+        {
+            build(spheres);
+            return;
+        }
+
+        refit(spheres);
+        if (area(nodes[0]) > BVH_REBUILD_GROWTH * builtArea)
+        {
+            build(spheres);
+        }
+    }
+
+    // Appends the ids of the instances that may be inside the frustum
+    void cull(const Frustum &frustum, std::vector<int> &out) const
+    {
+        out.insert(out.end(), unbounded.begin(), unbounded.end());
+        if (nodes.empty())
+        {
+            return;
+        }
+
+        // Each entry carries the planes its box still straddles, children of a box fully
+        // inside a plane skip that plane
+        std::pair<int, int> stack[64];
+        int top = 0;
+        stack[top++] = {0, 0x3f};
+        while (top > 0)
+        {
+            auto [index, mask] = stack[--top];
+            const Node &node = nodes[index];
+
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; ++p)
+            {
+                if (!(mask & (1 << p)))
+                {
+                    continue;
+                }
+                const glm::vec4 &plane = frustum.planes[p];
+                glm::vec3 far(plane.x >= 0 ? node.upper.x : node.lower.x,
+                              plane.y >= 0 ? node.upper.y : node.lower.y,
+                              plane.z >= 0 ? node.upper.z : node.lower.z);
+                glm::vec3 near(plane.x >= 0 ? node.lower.x : node.upper.x,
+                               plane.y >= 0 ? node.lower.y : node.upper.y,
+                               plane.z >= 0 ? node.lower.z : node.upper.z);
+                if (glm::dot(glm::vec3(plane), far) + plane.w < 0.0f)
+                {
+                    outside = true;
+                }
+                else if (glm::dot(glm::vec3(plane), near) + plane.w >= 0.0f)
+                {
+                    mask &= ~(1 << p);
+                }
+            }
+            if (outside)
+            {
+                continue;
+            }
+
+            if (node.count > 0 || mask == 0)
+            {
+                // Leaf, or a subtree entirely inside: take every instance below it without more tests
+                int last = node.count > 0 ? node.first + node.count : subtreeEnd[index];
+                int first = node.count > 0 ? node.first : subtreeBegin[index];
+                out.insert(out.end(), items.begin() + first, items.begin() + last);
+                continue;
+            }
+            stack[top++] = {node.first, mask};
+            stack[top++] = {index + 1, mask};
+        }
+    }
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+private:
+    struct Node
+    {
+        glm::vec3 lower;
+        int first; // Leaves: first item; inner nodes: right child (the left child is the next node)
+        glm::vec3 upper;
+        int count; // Items in a leaf, 0 for inner nodes
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> items;                     // Instance ids, each leaf and each subtree is a contiguous range
+    std::vector<int> subtreeBegin, subtreeEnd;  // Item range under each node
+    std::vector<int> unbounded;                 // Instances that are never culled
+    size_t instanceCount = 0;
+    float builtArea = 0.0f;
+
+    static float area(const Node &node)
+    {
+        glm::vec3 e = glm::max(node.upper - node.lower, glm::vec3(0.0f));
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    void build(const std::vector<glm::vec4> &spheres)
+    {
+        instanceCount = spheres.size();
+        nodes.clear();
+        items.clear();
+        unbounded.clear();
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            (spheres[i].w < 0.0f ? unbounded : items).push_back(static_cast<int>(i));
+        }
+        if (items.empty())
+        {
+            return;
+        }
+
+        nodes.reserve(2 * items.size() / BVH_LEAF_SIZE + 1);
+        subtreeBegin.clear();
+        subtreeEnd.clear();
+        buildNode(spheres, 0, static_cast<int>(items.size()));
+        builtArea = std::max(area(nodes[0]), 1e-12f);
+    }
+
+    int buildNode(const std::vector<glm::vec4> &spheres, int begin, int end)
+    {
+        int index = static_cast<int>(nodes.size());
+        nodes.push_back(Node{});
+        subtreeBegin.push_back(begin);
+        subtreeEnd.push_back(end);
+
+        glm::vec3 lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max());
+        glm::vec3 centerLower = lower, centerUpper = upper;
+        for (int i = begin; i < end; ++i)
+        {
+            const glm::vec4 &s = spheres[items[i]];
+            lower = glm::min(lower, glm::vec3(s) - s.w);
+            upper = glm::max(upper, glm::vec3(s) + s.w);
+            centerLower = glm::min(centerLower, glm::vec3(s));
+            centerUpper = glm::max(centerUpper, glm::vec3(s));
+        }
+
+        if (end - begin <= BVH_LEAF_SIZE)
+        {
+            nodes[index] = Node{lower, begin, upper, end - begin};
+            return index;
+        }
+
+        // Median split along the axis where the centers spread the most
+        glm::vec3 extent = centerUpper - centerLower;
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        int middle = (begin + end) / 2;
+        std::nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end,
+                         [&](int a, int b)
+                         { return spheres[a][axis] < spheres[b][axis]; });
+
+        buildNode(spheres, begin, middle);
+        int right = buildNode(spheres, middle, end);
+        nodes[index] = Node{lower, right, upper, 0};
+        return index;
+    }
+
+    // Children always follow their parent, so one backwards pass sees them before the parent
+    void refit(const std::vector<glm::vec4> &spheres)
+    {
+        for (int index = static_cast<int>(nodes.size()) - 1; index >= 0; --index)
+        {
+            Node &node = nodes[index];
+            if (node.count > 0)
+            {
+                float lx = std::numeric_limits<float>::max(), ly = lx, lz = lx;
+                float ux = -lx, uy = -lx, uz = -lx;
+                for (int i = node.first; i < node.first + node.count; ++i)
+                {
+                    const glm::vec4 &s = spheres[items[i]];
+                    lx = std::min(lx, s.x - s.w);
+                    ly = std::min(ly, s.y - s.w);
+                    lz = std::min(lz, s.z - s.w);
+                    ux = std::max(ux, s.x + s.w);
+                    uy = std::max(uy, s.y + s.w);
+                    uz = std::max(uz, s.z + s.w);
+                }
+                node.lower = glm::vec3(lx, ly, lz);
+                node.upper = glm::vec3(ux, uy, uz);
+                continue;
+            }
+            const Node &left = nodes[index + 1];
+            const Node &right = nodes[node.first];
+            node.lower = glm::vec3(std::min(left.lower.x, right.lower.x), std::min(left.lower.y, right.lower.y), std::min(left.lower.z, right.lower.z));
+            node.upper = glm::vec3(std::max(left.upper.x, right.upper.x), std::max(left.upper.y, right.upper.y), std::max(left.upper.z, right.upper.z));
+        }
+    }
+};
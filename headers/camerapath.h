@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+// Camera keyframes, one per line, '#' starts a comment:
+//
+//   <frame> <position x y z> <target x y z>
+//
+// Frames must increase; the camera moves linearly between keyframes and holds the last one.
+struct CameraKeyframe
+{
+    int frame;
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+struct CameraPath
+{
+    std::vector<CameraKeyframe> keyframes;
+
+    bool empty() const
+    {
+        return keyframes.empty();
+    }
+
+    // Moves the camera to where the path is at the given frame, keeping its up vector
+    void apply(int frame, Camera &camera) const
+    {
+        auto next = std::upper_bound(keyframes.begin(), keyframes.end(), frame,
+                                     [](int f, const CameraKeyframe &k)
+                                     { return f < k.frame; });
+        if (next == keyframes.begin())
+        {
+            camera.cameraPosition = next->position;
+            camera.targetPosition = next->target;
+            return;
+        }
+        if (next == keyframes.end())
+        {
+            camera.cameraPosition = keyframes.back().position;
+            camera.targetPosition = keyframes.back().target;
+            return;
+        }
+
+        const CameraKeyframe &previous = *(next - 1);
+        float t = static_cast<float>(frame - previous.frame) / static_cast<float>(next->frame - previous.frame);
+        camera.cameraPosition = glm::mix(previous.position, next->position, t);
+        camera.targetPosition = glm::mix(previous.target, next->target, t);
+    }
+};
+
+bool loadCameraPath(const std::string &path, CameraPath &cameraPath)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Error: Failed to open the camera path: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream iss(line);
+        CameraKeyframe key;
+        if (!(iss >> key.frame))
+        {
+            continue;
+        }
+        iss >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z;
+        if (iss.fail() || (!cameraPath.keyframes.empty() && key.frame <= cameraPath.keyframes.back().frame))
+        {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": malformed keyframe" << std::endl;
+            return false;
+        }
+        cameraPath.keyframes.push_back(key);
+    }
+
+    if (cameraPath.keyframes.empty())
+    {
+        std::cerr << "Error: " << path << ": no keyframes" << std::endl;
+        return false;
+    }
+    return true;
+}
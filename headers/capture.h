@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "framebuffer.h"
+#include "trace.h"
+
+constexpr int CAPTURE_RING_SIZE = 8; // Frames buffered between the render loop and the writer thread
+
+enum CaptureFormat
+{
+    CAPTURE_PPM, // One binary PPM per frame in a directory
+    CAPTURE_Y4M  // A single YUV4MPEG2 4:2:0 stream
+};
+
+// Streams rendered frames to disk from a background thread.
+// submit() copies the framebuffer into a free slot of a fixed ring and returns; when every slot is
+// still waiting to be written the frame is dropped (or, with wait, the caller blocks until one frees up).
+class FrameExporter
+{
+public:
+    ~FrameExporter()
+    {
+        stop();
+    }
+
+    // path is the output directory for CAPTURE_PPM, the stream file for CAPTURE_Y4M
+    bool start(const std::string &path, CaptureFormat captureFormat, int fps)
+    {
+        format = captureFormat;
+        directory = path;
+        if (format == CAPTURE_Y4M)
+        {
+            stream.open(path, std::ios::binary);
+            if (!stream)
+            {
+                return false;
+            }
+            stream << "YUV4MPEG2 W" << SCREEN_WIDTH << " H" << SCREEN_HEIGHT << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+            luma.resize(SCREEN_WIDTH * SCREEN_HEIGHT);
+            chroma.resize(SCREEN_WIDTH * SCREEN_HEIGHT / 2);
+        }
+
+        for (auto &slot : ring)
+        {
+            slot.resize(SCREEN_WIDTH * SCREEN_HEIGHT * 3);
+        }
+
+        running = true;
+        writer = std::thread(&FrameExporter::writerLoop, this);
+        return true;
+    }
+
+    // Writes out everything already queued, then joins the writer
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+        if (stream.is_open())
+        {
+            stream.close();
+        }
+    }
+
+    bool active() const
+    {
+        return writer.joinable();
+    }
+
+    // Queues the current framebuffer as render frame number frame, returns false if it was dropped.
+    // PPM files are named after frame, so dropped frames leave gaps instead of shifting later files
+    bool submit(uint64_t frame, bool wait = false)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wait)
+            {
+                freed.wait(lock, [this]
+                           { return queued < CAPTURE_RING_SIZE; });
+            }
+            else if (queued == CAPTURE_RING_SIZE)
+            {
+                ++dropped;
+                return false;
+            }
+        }
+
+        // Only the render thread advances tail and the writer never reads past queued, so the copy needs no lock
+        std::vector<uint8_t> &slot = ring[tail % CAPTURE_RING_SIZE];
+        frameOf[tail % CAPTURE_RING_SIZE] = frame;
+        for (size_t y = 0; y < SCREEN_HEIGHT; y++)
+        {
+            size_t framebufferY = SCREEN_HEIGHT - y - 1; // Same row order as renderBuffer
+            uint8_t *row = slot.data() + y * SCREEN_WIDTH * 3;
+            for (size_t x = 0; x < SCREEN_WIDTH; x++)
+            {
+                const Color &color = framebuffer[framebufferY * SCREEN_WIDTH + x].color;
+                row[3 * x] = color.r;
+                row[3 * x + 1] = color.g;
+                row[3 * x + 2] = color.b;
+            }
+        }
+        ++tail;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++queued;
+            maxQueued = std::max(maxQueued, queued);
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    int queueDepth()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queued;
+    }
+
+    int maxQueueDepth()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return maxQueued;
+    }
+
+    uint64_t droppedFrames() const
+    {
+        return dropped;
+    }
+
+    uint64_t writtenFrames() const
+    {
+        return written;
+    }
+
+    uint64_t failedFrames() const
+    {
+        return failed;
+    }
+
+private:
+    std::array<std::vector<uint8_t>, CAPTURE_RING_SIZE> ring;
+    std::array<uint64_t, CAPTURE_RING_SIZE> frameOf{}; // Render frame number held by each slot
+    uint64_t tail = 0; // Next slot the render thread fills
+    uint64_t head = 0; // Next slot the writer drains
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable freed;
+    std::thread writer;
+    bool running = false;
+    int queued = 0;
+    int maxQueued = 0;
+
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> failed{0};
+
+    CaptureFormat format = CAPTURE_PPM;
+    std::string directory;
+    std::ofstream stream;
+    std::vector<uint8_t> luma;
+    std::vector<uint8_t> chroma; // U plane followed by the V plane
+
+    void writerLoop()
+    {
+        tracer.nameThread("frame writer");
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]
+                          { return queued > 0 || !running; });
+                if (queued == 0)
+                {
+                    return;
+                }
+            }
+
+            size_t slot = head % CAPTURE_RING_SIZE;
+            TraceScope trace("writeFrame", "io", static_cast<int64_t>(frameOf[slot]));
+            bool ok = format == CAPTURE_Y4M ? writeY4M(ring[slot]) : writePPM(ring[slot], frameOf[slot]);
+            if (ok)
+            {
+                ++written;
+            }
+            else
+            {
+                ++failed;
+            }
+            ++head;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --queued;
+            }
+            freed.notify_one();
+        }
+    }
+
+    bool writePPM(const std::vector<uint8_t> &rgb, uint64_t frame)
+    {
+        std::ostringstream path;
+        path << directory << "/frame_" << std::setw(5) << std::setfill('0') << frame << ".ppm";
+
+        std::ofstream file(path.str(), std::ios::binary);
+        file << "P6\n" << SCREEN_WIDTH << " " << SCREEN_HEIGHT << "\n255\n";
+        file.write(reinterpret_cast<const char *>(rgb.data()), rgb.size());
+        return static_cast<bool>(file);
+    }
+
+    // BT.601 studio range, chroma averaged over each 2x2 block
+    bool writeY4M(const std::vector<uint8_t> &rgb)
+    {
+        for (size_t i = 0; i < luma.size(); ++i)
+        {
+            int r = rgb[3 * i], g = rgb[3 * i + 1], b = rgb[3 * i + 2];
+            luma[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+
+        const size_t chromaWidth = SCREEN_WIDTH / 2;
+        const size_t planeSize = chromaWidth * (SCREEN_HEIGHT / 2);
+        for (size_t cy = 0; cy < SCREEN_HEIGHT / 2; ++cy)
+        {
+            for (size_t cx = 0; cx < chromaWidth; ++cx)
+            {
+                int r = 0, g = 0, b = 0;
+                for (size_t dy = 0; dy < 2; ++dy)
+                {
+                    const uint8_t *pixel = rgb.data() + ((2 * cy + dy) * SCREEN_WIDTH + 2 * cx) * 3;
+                    r += pixel[0] + pixel[3];
+                    g += pixel[1] + pixel[4];
+                    b += pixel[2] + pixel[5];
+                }
+                r /= 4;
+                g /= 4;
+                b /= 4;
+                chroma[cy * chromaWidth + cx] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                chroma[planeSize + cy * chromaWidth + cx] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+
+        stream << "FRAME\n";
+        stream.write(reinterpret_cast<const char *>(luma.data()), luma.size());
+        stream.write(reinterpret_cast<const char *>(chroma.data()), chroma.size());
+        return static_cast<bool>(stream);
+    }
+};
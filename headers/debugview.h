@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "color.h"
+#include "fragment.h"
+#include "framebuffer.h"
+
+// What the framebuffer shows after the scene is drawn
+enum DebugView
+{
+    VIEW_FINAL,       // Shaded colors
+    VIEW_OVERDRAW,    // Fragments shaded per pixel, visible or not
+    VIEW_SHADER_COST, // Cycles spent in fragment shading per pixel
+    VIEW_MODEL_ID,    // Model that wrote the visible pixel
+    VIEW_COUNT
+};
+
+const char *debugViewNames[VIEW_COUNT] = {"final", "overdraw", "cost", "model"};
+
+constexpr int OVERDRAW_RAMP_MAX = 8; // Fragments per pixel mapped to the hot end of the ramp
+
+// Time stamp counter where available, nanoseconds otherwise
+inline uint64_t readCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Blue, cyan, green, yellow, red as t goes from 0 to 1
+Color heatColor(float t)
+{
+    static const glm::vec3 stops[] = {
+        glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.8f, 1.0f), glm::vec3(0.0f, 0.9f, 0.0f),
+        glm::vec3(1.0f, 0.9f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)};
+    constexpr int last = sizeof(stops) / sizeof(stops[0]) - 1;
+
+    float x = glm::clamp(t, 0.0f, 1.0f) * last;
+    int i = std::min(static_cast<int>(x), last - 1);
+    glm::vec3 c = glm::mix(stops[i], stops[i + 1], x - i);
+    return Color(c.r, c.g, c.b);
+}
+
+// Per-pixel shading statistics gathered next to the framebuffer while a debug view is on
+class DebugBuffers
+{
+public:
+    DebugView view = VIEW_FINAL;
+
+    // Frame totals, and the same summed over every debug frame of the run
+    struct Totals
+    {
+        uint64_t fragments = 0; // Shaded, visible or not
+        uint64_t pixels = 0;    // Covered by at least one fragment
+        uint64_t cycles = 0;
+        int maxOverdraw = 0;
+        int models = 0;         // Models that own at least one visible pixel
+    };
+    Totals frame;
+    Totals run;
+
+    bool active() const
+    {
+        return view != VIEW_FINAL;
+    }
+
+    void beginFrame()
+    {
+        if (!active())
+        {
+            return;
+        }
+        std::fill(overdraw.begin(), overdraw.end(), 0);
+        std::fill(cost.begin(), cost.end(), 0);
+        std::fill(owner.begin(), owner.end(), -1);
+        frame = Totals();
+    }
+
+    // written: the fragment passed the depth test, see point()
+    void record(const Fragment &fragment, int model, uint64_t cycles, bool written)
+    {
+        int index = fragment.y * SCREEN_WIDTH + fragment.x;
+        ++overdraw[index];
+        cost[index] += cycles;
+        if (written)
+        {
+            owner[index] = model;
+        }
+    }
+
+    // Replaces the framebuffer colors with the selected view and sums the frame totals
+    void resolve()
+    {
+        if (!active())
+        {
+            return;
+        }
+
+        uint64_t maxCost = 1;
+        std::vector<bool> visibleModels;
+        for (size_t i = 0; i < overdraw.size(); ++i)
+        {
+            frame.fragments += overdraw[i];
+            frame.pixels += overdraw[i] > 0;
+            frame.cycles += cost[i];
+            frame.maxOverdraw = std::max(frame.maxOverdraw, static_cast<int>(overdraw[i]));
+            maxCost = std::max(maxCost, cost[i]);
+            if (owner[i] >= 0)
+            {
+                visibleModels.resize(std::max<size_t>(visibleModels.size(), owner[i] + 1));
+                visibleModels[owner[i]] = true;
+            }
+        }
+        frame.models = static_cast<int>(std::count(visibleModels.begin(), visibleModels.end(), true));
+
+        run.fragments += frame.fragments;
+        run.pixels += frame.pixels;
+        run.cycles += frame.cycles;
+        run.maxOverdraw = std::max(run.maxOverdraw, frame.maxOverdraw);
+        run.models = std::max(run.models, frame.models);
+
+        for (size_t i = 0; i < overdraw.size(); ++i)
+        {
+            Color color;
+            switch (view)
+            {
+            case VIEW_OVERDRAW:
+                color = overdraw[i] ? heatColor(static_cast<float>(overdraw[i] - 1) / (OVERDRAW_RAMP_MAX - 1)) : Color();
+                break;
+            case VIEW_SHADER_COST:
+                // Square root so cheap pixels stay distinguishable next to the most expensive one
+                color = cost[i] ? heatColor(std::sqrt(static_cast<float>(cost[i]) / maxCost)) : Color();
+                break;
+            case VIEW_MODEL_ID:
+                color = owner[i] >= 0 ? modelColor(owner[i]) : Color();
+                break;
+            default:
+                break;
+            }
+            framebuffer[i].color = color;
+        }
+    }
+
+private:
+    std::array<uint16_t, SCREEN_WIDTH * SCREEN_HEIGHT> overdraw{};
+    std::array<uint64_t, SCREEN_WIDTH * SCREEN_HEIGHT> cost{};
+    std::array<int, SCREEN_WIDTH * SCREEN_HEIGHT> owner{};
+
+    // Golden-ratio hue steps keep neighbouring ids apart
+    static Color modelColor(int model)
+    {
+        float hue = glm::fract(model * 0.618034f) * 6.0f;
+        glm::vec3 c = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f), 2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+        return Color(0.2f + 0.8f * c.r, 0.2f + 0.8f * c.g, 0.2f + 0.8f * c.b);
+    }
+};
+
+DebugBuffers debugBuffers;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "framebuffer.h"
+#include "uniforms.h"
+
+// Approximate on-screen radius in pixels of a model's bounding sphere
+float projectedRadius(const glm::mat4 &model, float boundingRadius, const Uniforms &uniforms)
+{
+    glm::vec4 center = uniforms.view * model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Largest axis scale of the model matrix, so non-uniform scales stay conservative
+    float scale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+    float worldRadius = boundingRadius * scale;
+
+    // The view looks down -z, anything at or behind the eye covers the whole screen
+    float depth = -center.z;
+    if (depth <= worldRadius)
+    {
+        return static_cast<float>(std::max(SCREEN_WIDTH, SCREEN_HEIGHT));
+    }
+
+    return worldRadius * uniforms.projection[1][1] * (SCREEN_HEIGHT / 2.0f) / depth;
+}
+
+// Same estimate for a world-space bounding sphere (center, radius), measured at the sphere's nearest
+// depth rather than its center so it errs on the large side
+float projectedRadius(const glm::vec4 &sphere, const Uniforms &uniforms)
+{
+    glm::vec4 center = uniforms.view * glm::vec4(glm::vec3(sphere), 1.0f);
+    float nearest = -center.z - sphere.w;
+    if (nearest <= 0.0f)
+    {
+        return static_cast<float>(std::max(SCREEN_WIDTH, SCREEN_HEIGHT));
+    }
+
+    return sphere.w * uniforms.projection[1][1] * (SCREEN_HEIGHT / 2.0f) / nearest;
+}
@@ -1,32 +1,102 @@
 #pragma once  
 
 #include <glm/glm.hpp>  
+#include <cmath>
 #include <cstdint>      
+#include <vector>
 #include "color.h"      
 
-// Struct to represent a vertex with essential attributes for 3D rendering
+// Unit normal packed into two 16-bit snorm values with an octahedral mapping
+struct PackedNormal {
+  int16_t x;
+  int16_t y;
+};
+
+PackedNormal packNormal(const glm::vec3& n) {
+  glm::vec2 p = glm::vec2(n.x, n.y) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+  if (n.z < 0) {
+    // Fold the lower hemisphere over the diagonals
+    p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0 ? 1.0f : -1.0f),
+                  (1.0f - std::abs(p.x)) * (p.y >= 0 ? 1.0f : -1.0f));
+  }
+  return PackedNormal{
+    static_cast<int16_t>(std::round(glm::clamp(p.x, -1.0f, 1.0f) * 32767.0f)),
+    static_cast<int16_t>(std::round(glm::clamp(p.y, -1.0f, 1.0f) * 32767.0f))
+  };
+}
+
+glm::vec3 unpackNormal(PackedNormal packed) {
+  glm::vec2 p(packed.x / 32767.0f, packed.y / 32767.0f);
+  glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+  if (n.z < 0) {
+    n.x = (1.0f - std::abs(p.y)) * (p.x >= 0 ? 1.0f : -1.0f);
+    n.y = (1.0f - std::abs(p.x)) * (p.y >= 0 ? 1.0f : -1.0f);
+  }
+  return glm::normalize(n);
+}
+
+// Struct to represent a transformed vertex with essential attributes for rasterization (36 bytes)
 struct Vertex {
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec3 tex;
-  glm::vec3 worldPos;
-  glm::vec3 originalPos;
+  glm::vec3 position;    // Screen space, z is depth
+  PackedNormal normal;   // World space
+  glm::vec2 tex;
+  glm::vec3 originalPos; // Object space, only read by shaders that need it
 };
 
-// Struct to encapsulate data for fragments processed during the rasterization phase
+// Struct to encapsulate data for fragments processed during the rasterization phase (40 bytes)
+// originalPos stays inline because a FragmentShader sees one Fragment at a time, so it costs 12 bytes
+// per fragment even when zero. Paths that never read it rasterize into a FragmentBatch instead.
 struct Fragment {
   uint16_t x;
   uint16_t y;
-  double z;
+  float z;
   Color color;
   float intensity;
-  glm::vec3 worldPos;
-  glm::vec3 originalPos;
+  glm::vec2 uv;
+  float footprint;       // UV units covered by one pixel, 0 shades every noise layer
+  glm::vec3 originalPos; // Only interpolated for shaders that read it, see triangle()
 };
 
 // Struct for holding the final color and depth information of a fragment
 struct FragColor {
   Color color;
-  double z;
+  float z;
+};
+
+// Structure-of-arrays fragment list, one contiguous array per attribute, without originalPos.
+// The virtual texture path rasterizes straight into it, see triangle() and renderModel().
+struct FragmentBatch {
+  std::vector<uint16_t> x;
+  std::vector<uint16_t> y;
+  std::vector<float> z;
+  std::vector<float> intensity;
+  std::vector<float> u;
+  std::vector<float> v;
+  std::vector<float> footprint;
+  std::vector<Color> color;
+
+  size_t size() const { return x.size(); }
+
+  void clear() {
+    x.clear(); y.clear(); z.clear(); intensity.clear();
+    u.clear(); v.clear(); footprint.clear(); color.clear();
+  }
+
+  void push_back(const Fragment& f) {
+    x.push_back(f.x);
+    y.push_back(f.y);
+    z.push_back(f.z);
+    intensity.push_back(f.intensity);
+    u.push_back(f.uv.x);
+    v.push_back(f.uv.y);
+    footprint.push_back(f.footprint);
+    color.push_back(f.color);
+  }
+
+  // Rebuilds one fragment for the depth test and debug views
+  Fragment operator[](size_t i) const {
+    return Fragment{x[i], y[i], z[i], color[i], intensity[i], glm::vec2(u[i], v[i]), footprint[i], glm::vec3(0.0f)};
+  }
 };
 
+typedef Fragment (*FragmentShader)(Fragment &);
@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <cstdint>
 #include <algorithm>
 #include <glm/glm.hpp>
 #include <limits>
@@ -12,29 +13,35 @@ constexpr size_t SCREEN_HEIGHT = 600;
 
 FragColor blank{
     Color{0, 0, 0},
-    std::numeric_limits<double>::max()};
+    std::numeric_limits<float>::max()};
 
 FragColor star{
     Color{255, 255, 255},
-    std::numeric_limits<double>::max()};
+    std::numeric_limits<float>::max()};
 
 FragColor star2{
     Color{230, 227, 227},
-    std::numeric_limits<double>::max()};
+    std::numeric_limits<float>::max()};
 
 std::array<FragColor, SCREEN_WIDTH * SCREEN_HEIGHT> framebuffer;
 
 // Create a 2D array of mutexes
 std::array<std::mutex, SCREEN_WIDTH * SCREEN_HEIGHT> mutexes;
 
-void point(Fragment f)
+uint64_t shadedPixels = 0; // Fragments that passed the depth test, over the whole run
+
+// Returns whether the fragment passed the depth test
+bool point(Fragment f)
 {
     std::lock_guard<std::mutex> lock(mutexes[f.y * SCREEN_WIDTH + f.x]);
 
     if (f.z < framebuffer[f.y * SCREEN_WIDTH + f.x].z)
     {
         framebuffer[f.y * SCREEN_WIDTH + f.x] = FragColor{f.color, f.z};
+        ++shadedPixels;
+        return true;
     }
+    return false;
 }
 
 void clearFramebuffer()
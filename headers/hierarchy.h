@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "orbits.h"
+#include "parallel.h"
+
+constexpr size_t HIERARCHY_CHUNK = 4096; // Nodes per task, levels with fewer nodes are updated on the calling thread
+
+// Parent/child transforms with cached world matrices.
+// A node's world matrix is recomputed only when its local transform or one of its ancestors changed.
+// Nodes driven by an orbit take their local matrix from OrbitArrays and change every frame.
+class TransformHierarchy
+{
+public:
+    // Parents must be added before their children, -1 for a root
+    int add(int parent, const glm::mat4 &local = glm::mat4(1.0f), int orbit = -1)
+    {
+        int node = static_cast<int>(parents.size());
+        parents.push_back(parent);
+        orbits.push_back(orbit);
+        locals.push_back(local);
+        worlds.push_back(local);
+        previousWorlds.push_back(local);
+        dirty.push_back(1);
+        changed.push_back(0);
+        depths.push_back(parent < 0 ? 0 : depths[parent] + 1);
+
+        if (levels.size() <= depths[node])
+        {
+            levels.resize(depths[node] + 1);
+        }
+        levels[depths[node]].push_back(node);
+        return node;
+    }
+
+    void setLocal(int node, const glm::mat4 &local)
+    {
+        if (locals[node] != local)
+        {
+            locals[node] = local;
+            dirty[node] = 1;
+        }
+    }
+
+    const glm::mat4 &world(int node) const
+    {
+        return worlds[node];
+    }
+
+    // World matrix before the latest update, equal to world() for nodes that did not move in it
+    const glm::mat4 &previousWorld(int node) const
+    {
+        return changed[node] ? previousWorlds[node] : worlds[node];
+    }
+
+    // World matrix blended between the previous update and the latest one, alpha in [0, 1].
+    // Each basis column is lerped then rescaled to the lerped length, so spins and scales
+    // stay rigid instead of shrinking halfway through a rotation
+    glm::mat4 interpolated(int node, float alpha) const
+    {
+        if (!changed[node])
+        {
+            return worlds[node];
+        }
+
+        const glm::mat4 &from = previousWorlds[node];
+        const glm::mat4 &to = worlds[node];
+        glm::mat4 m;
+        for (int c = 0; c < 3; ++c)
+        {
+            glm::vec3 a(from[c]), b(to[c]);
+            glm::vec3 column = glm::mix(a, b, alpha);
+            float length = glm::length(column);
+            float target = glm::mix(glm::length(a), glm::length(b), alpha);
+            m[c] = glm::vec4(length > 0.0f ? column * (target / length) : column, 0.0f);
+        }
+        m[3] = glm::mix(from[3], to[3], alpha);
+        return m;
+    }
+
+    size_t size() const
+    {
+        return parents.size();
+    }
+
+    // Recomposes the world matrices that went stale, one depth level at a time so every parent
+    // is final before its children read it; nodes of the same level are independent and run in parallel
+    void update(const OrbitArrays &orbitArrays)
+    {
+        for (const auto &level : levels)
+        {
+            int chunks = static_cast<int>((level.size() + HIERARCHY_CHUNK - 1) / HIERARCHY_CHUNK);
+            auto updateChunk = [&](int chunk)
+            {
+                size_t end = std::min(level.size(), (chunk + 1) * HIERARCHY_CHUNK);
+                for (size_t i = chunk * HIERARCHY_CHUNK; i < end; ++i)
+                {
+                    updateNode(level[i], orbitArrays);
+                }
+            };
+
+            // The shared pool's threads sleep between levels, a level of a single chunk stays on this thread
+            parallelRows(chunks, updateChunk);
+        }
+    }
+
+private:
+    std::vector<int> parents;
+    std::vector<int> orbits;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat4> previousWorlds; // World matrix before the latest update, for interpolation
+    std::vector<uint8_t> dirty;   // Local transform changed since the last update
+    std::vector<uint8_t> changed; // World matrix changed in the current update, read by the children
+    std::vector<size_t> depths;
+    std::vector<std::vector<int>> levels; // Node ids grouped by depth
+
+    void updateNode(int node, const OrbitArrays &orbitArrays)
+    {
+        int parent = parents[node];
+        bool parentChanged = parent >= 0 && changed[parent];
+        bool orbiting = orbits[node] >= 0;
+
+        if (!dirty[node] && !orbiting && !parentChanged)
+        {
+            if (changed[node])
+            {
+                // Moved in the previous update but not in this one, stop interpolating
+                previousWorlds[node] = worlds[node];
+                changed[node] = 0;
+            }
+            return;
+        }
+        changed[node] = 1;
+        dirty[node] = 0;
+        previousWorlds[node] = worlds[node];
+
+        const glm::mat4 &local = orbiting ? orbitArrays.matrices[orbits[node]] : locals[node];
+        worlds[node] = parent >= 0 ? worlds[parent] * local : local;
+    }
+};
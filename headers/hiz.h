@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <glm/glm.hpp>
+#include "footprint.h"
+#include "framebuffer.h"
+#include "uniforms.h"
+
+constexpr float HIZ_OCCLUDER_RADIUS = 32.0f; // On-screen radius in pixels from which a model is drawn before the pyramid is built
+constexpr float HIZ_MARGIN = 1.25f;          // Slack on the projected radius, which is only an estimate off-axis
+
+// Hierarchical depth buffer: level 0 holds the farthest depth of each 2x2 pixel block of the
+// framebuffer, every next level the farthest of 2x2 texels of the previous one.
+// A model whose nearest depth is behind the farthest depth under its screen rectangle is hidden.
+class DepthPyramid
+{
+public:
+    void build()
+    {
+        levels.clear();
+        widths.clear();
+        heights.clear();
+
+        int width = (SCREEN_WIDTH + 1) / 2, height = (SCREEN_HEIGHT + 1) / 2;
+        levels.emplace_back(width * height);
+        widths.push_back(width);
+        heights.push_back(height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                int x0 = 2 * x, y0 = 2 * y;
+                int x1 = std::min(x0 + 1, static_cast<int>(SCREEN_WIDTH) - 1), y1 = std::min(y0 + 1, static_cast<int>(SCREEN_HEIGHT) - 1);
+                levels[0][y * width + x] = std::max(
+                    std::max(framebuffer[y0 * SCREEN_WIDTH + x0].z, framebuffer[y0 * SCREEN_WIDTH + x1].z),
+                    std::max(framebuffer[y1 * SCREEN_WIDTH + x0].z, framebuffer[y1 * SCREEN_WIDTH + x1].z));
+            }
+        }
+
+        while (width > 1 || height > 1)
+        {
+            const std::vector<float> &previous = levels.back();
+            int previousWidth = width, previousHeight = height;
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+
+            std::vector<float> level(width * height);
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    int x0 = 2 * x, y0 = 2 * y;
+                    int x1 = std::min(x0 + 1, previousWidth - 1), y1 = std::min(y0 + 1, previousHeight - 1);
+                    level[y * width + x] = std::max(
+                        std::max(previous[y0 * previousWidth + x0], previous[y0 * previousWidth + x1]),
+                        std::max(previous[y1 * previousWidth + x0], previous[y1 * previousWidth + x1]));
+                }
+            }
+            levels.push_back(std::move(level));
+            widths.push_back(width);
+            heights.push_back(height);
+        }
+    }
+
+    // Whether a world-space bounding sphere (center, radius) is certainly behind what is already drawn
+    bool occluded(const glm::vec4 &sphere, const Uniforms &uniforms) const
+    {
+        if (levels.empty())
+        {
+            return false;
+        }
+
+        // Nearest point of the sphere along the view axis; spheres reaching the near side stay visible
+        glm::vec4 viewCenter = uniforms.view * glm::vec4(glm::vec3(sphere), 1.0f);
+        float nearestZ = viewCenter.z + sphere.w;
+        if (nearestZ >= 0.0f)
+        {
+            return false;
+        }
+        glm::vec4 clip = uniforms.projection * glm::vec4(0.0f, 0.0f, nearestZ, 1.0f);
+        float nearestDepth = uniforms.viewport[2][2] * (clip.z / clip.w) + uniforms.viewport[3][2];
+
+        glm::vec4 screen = uniforms.viewport * uniforms.projection * viewCenter;
+        if (screen.w <= 0.0f)
+        {
+            return false;
+        }
+        glm::vec2 center = glm::vec2(screen.x, screen.y) / screen.w;
+        float radius = projectedRadius(sphere, uniforms) * HIZ_MARGIN + 1.0f;
+
+        // Pixel rectangle clamped to the screen, in level-0 texels (2x2 pixels)
+        int x0 = std::max(0, static_cast<int>(center.x - radius)) / 2;
+        int y0 = std::max(0, static_cast<int>(center.y - radius)) / 2;
+        int x1 = std::min(static_cast<int>(SCREEN_WIDTH) - 1, static_cast<int>(center.x + radius)) / 2;
+        int y1 = std::min(static_cast<int>(SCREEN_HEIGHT) - 1, static_cast<int>(center.y + radius)) / 2;
+        if (x0 > x1 || y0 > y1)
+        {
+            return false;
+        }
+
+        // Coarsest level detail where the rectangle spans at most 2x2 texels
+        size_t level = 0;
+        while (level + 1 < levels.size() && (x1 - x0 > 1 || y1 - y0 > 1))
+        {
+            x0 >>= 1;
+            y0 >>= 1;
+            x1 >>= 1;
+            y1 >>= 1;
+            ++level;
+        }
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            for (int x = x0; x <= x1; ++x)
+            {
+                if (nearestDepth <= levels[level][y * widths[level] + x])
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::vector<float>> levels;
+    std::vector<int> widths, heights;
+};
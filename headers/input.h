@@ -0,0 +1,157 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Camera input reduced to what the main loop reacts to, so a session can be recorded and replayed frame by frame
+enum InputType
+{
+    INPUT_QUIT,
+    INPUT_KEY,  // value is the SDL keycode
+    INPUT_WHEEL // value is the wheel direction
+};
+
+struct InputEvent
+{
+    int frame;
+    InputType type;
+    int value;
+};
+
+const char *inputTypeNames[] = {"quit", "key", "wheel"};
+
+// Drains the SDL queue into input events for this frame
+void pollInput(int frame, std::vector<InputEvent> &out)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        if (event.type == SDL_QUIT)
+        {
+            out.push_back(InputEvent{frame, INPUT_QUIT, 0});
+        }
+        else if (event.type == SDL_KEYDOWN)
+        {
+            out.push_back(InputEvent{frame, INPUT_KEY, static_cast<int>(event.key.keysym.sym)});
+        }
+        else if (event.type == SDL_MOUSEWHEEL && event.wheel.y != 0)
+        {
+            out.push_back(InputEvent{frame, INPUT_WHEEL, event.wheel.y > 0 ? 1 : -1});
+        }
+    }
+}
+
+// Writes one "<frame> <type> <value>" line per event, and a quit on the last frame so replays stop there
+class InputRecorder
+{
+public:
+    bool open(const std::string &path)
+    {
+        file.open(path);
+        if (file)
+        {
+            file << "# frame type value\n";
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool isOpen() const
+    {
+        return file.is_open();
+    }
+
+    void record(const std::vector<InputEvent> &events)
+    {
+        for (const InputEvent &event : events)
+        {
+            if (event.type != INPUT_QUIT)
+            {
+                file << event.frame << " " << inputTypeNames[event.type] << " " << event.value << "\n";
+            }
+        }
+    }
+
+    void finish(int frame)
+    {
+        file << frame << " quit 0\n";
+        file.close();
+    }
+
+private:
+    std::ofstream file;
+};
+
+class InputReplay
+{
+public:
+    bool load(const std::string &path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cerr << "Error: Failed to open the input recording: " << path << std::endl;
+            return false;
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line))
+        {
+            ++lineNumber;
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream iss(line);
+            InputEvent event;
+            std::string type;
+            if (!(iss >> event.frame))
+            {
+                continue;
+            }
+            iss >> type >> event.value;
+
+            bool known = false;
+            for (int t = INPUT_QUIT; t <= INPUT_WHEEL; ++t)
+            {
+                if (type == inputTypeNames[t])
+                {
+                    event.type = static_cast<InputType>(t);
+                    known = true;
+                }
+            }
+            if (iss.fail() || !known || (!events.empty() && event.frame < events.back().frame))
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed input event" << std::endl;
+                return false;
+            }
+            events.push_back(event);
+        }
+        return true;
+    }
+
+    // Appends the recorded events of this frame, frames must be asked for in increasing order
+    void eventsAt(int frame, std::vector<InputEvent> &out)
+    {
+        while (next < events.size() && events[next].frame < frame)
+        {
+            ++next;
+        }
+        while (next < events.size() && events[next].frame == frame)
+        {
+            out.push_back(events[next++]);
+        }
+    }
+
+    // Whether every recorded event has been handed out
+    bool finished() const
+    {
+        return next >= events.size();
+    }
+
+private:
+    std::vector<InputEvent> events;
+    size_t next = 0;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ObjLoader.h"
+#include "uv.h"
+#include "vertexbatch.h"
+
+// Vertex data of one OBJ file, loaded once and shared by every model that uses it
+struct Mesh
+{
+    std::vector<glm::vec3> vertices; // Interleaved position, normal, tex triples
+    VertexStream stream;             // SoA copy of vertices for the batched vertex stage
+    float boundingRadius = 0.0f;     // Object-space radius around the origin, see boundingRadius()
+};
+
+// Center of the axis-aligned bounding box of a set of positions
+glm::vec3 meshCenter(const std::vector<glm::vec3> &positions)
+{
+    if (positions.empty())
+    {
+        return glm::vec3(0.0f);
+    }
+
+    glm::vec3 low = positions[0];
+    glm::vec3 high = positions[0];
+    for (const glm::vec3 &p : positions)
+    {
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    return 0.5f * (low + high);
+}
+
+std::vector<glm::vec3> createVBO(std::string path)
+{
+
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> texCoords;
+    std::vector<Face> faces;
+    std::vector<glm::vec3> vertexBufferObject; // This will contain both vertices and normals
+
+    loadOBJ(path.c_str(), vertices, normals, texCoords, faces);
+
+    // UVs are taken about the center of the bounding box, the sphere model is slightly off the origin
+    glm::vec3 center = meshCenter(vertices);
+
+    for (const auto &face : faces)
+    {
+        // Spherical UVs are generated here once instead of per fragment in the shaders
+        std::array<glm::vec2, 3> faceUV = triangleUV(
+            vertices[face.vertexIndices[0]],
+            vertices[face.vertexIndices[1]],
+            vertices[face.vertexIndices[2]],
+            center);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            // Get the vertex position
+            glm::vec3 vertexPosition = vertices[face.vertexIndices[i]];
+
+            // Get the normal for the current vertex
+            glm::vec3 vertexNormal = normals[face.normalIndices[i]];
+
+            // Get the texture for the current vertex
+            glm::vec3 vertexTexture = glm::vec3(faceUV[i], 0.0f);
+
+            // Add the vertex position and normal to the vertex array
+            vertexBufferObject.push_back(vertexPosition);
+            vertexBufferObject.push_back(vertexNormal);
+            vertexBufferObject.push_back(vertexTexture);
+        }
+    }
+
+    return vertexBufferObject;
+}
+
+// Radius of the sphere around the origin enclosing every position of a VBO (position, normal, tex triples)
+float boundingRadius(const std::vector<glm::vec3> &vertexBufferObject)
+{
+    float radius = 0.0f;
+    for (size_t i = 0; i < vertexBufferObject.size(); i += 3)
+    {
+        radius = std::max(radius, glm::length(vertexBufferObject[i]));
+    }
+    return radius;
+}
+
+// Loads an OBJ into a shared mesh, nullptr if the file has no faces
+std::shared_ptr<Mesh> loadMesh(const std::string &path)
+{
+    auto mesh = std::make_shared<Mesh>();
+    mesh->vertices = createVBO(path);
+    if (mesh->vertices.empty())
+    {
+        return nullptr;
+    }
+
+    mesh->stream = makeVertexStream(mesh->vertices);
+    mesh->boundingRadius = boundingRadius(mesh->vertices);
+    return mesh;
+}
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <vector>
+#include <memory>
+#include "mesh.h"
 #include "uniforms.h"
 
 enum ShaderType
@@ -15,15 +16,14 @@ enum ShaderType
     STAR
 };
 
+constexpr int SHADER_TYPE_COUNT = STAR + 1;
+
 class Model
 {
 public:
-    glm::mat4 modelMatrix;
-    std::vector<glm::vec3> vertices;
-    ShaderType currentShader;
-    float rotationSpeed;
-    float degrees = 0;
-    float degreesRotation;
-    float radius;
-    float translationSpeed;
-};
\ No newline at end of file
+    std::shared_ptr<const Mesh> mesh;
+    ShaderType currentShader = ROCKY;
+    int node = -1;          // TransformHierarchy node holding the model matrix
+    int texturePlanet = -1; // Virtual texture planet id, -1 to run the fragment shader directly
+    bool solid = true;      // Blocks the camera, false for the ships that travel with it
+};
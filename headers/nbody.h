@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "parallel.h"
+#include "simd.h"
+
+constexpr int NBODY_LEAF_SIZE = 8;    // Bodies per octree leaf and per force group, one AVX2 register of floats
+constexpr int NBODY_MORTON_BITS = 21; // Bits per axis of the Morton code, also the deepest octree level
+constexpr size_t NBODY_CHUNK = 1024;  // Bodies per task
+
+struct OctreeNode
+{
+    glm::vec3 centerOfMass;
+    float mass;
+    float size;          // Side of the node's cube
+    int first, count;    // Leaves: range in the Morton-sorted body order, count is 0 for inner nodes
+    int next;            // Id following the node's subtree. Nodes are stored depth first, so the subtree is [id, next)
+                         // and an inner node's first child is id + 1
+};
+
+// Sums the softened pull of every source (xyz position, w mass) on NBODY_LEAF_SIZE bodies into sum*,
+// without the gravitational constant
+void accumulateForces(const std::vector<glm::vec4> &sources, float softening2, const float *x, const float *y, const float *z,
+                      float *sumX, float *sumY, float *sumZ)
+{
+    for (const glm::vec4 &source : sources)
+    {
+        // Independent lanes, simple enough for the compiler to vectorize
+        for (int lane = 0; lane < NBODY_LEAF_SIZE; ++lane)
+        {
+            float dx = source.x - x[lane], dy = source.y - y[lane], dz = source.z - z[lane];
+            float r2 = dx * dx + dy * dy + dz * dz + softening2;
+            float f = source.w / (r2 * std::sqrt(r2));
+            sumX[lane] += dx * f;
+            sumY[lane] += dy * f;
+            sumZ[lane] += dz * f;
+        }
+    }
+}
+
+#if SIMD_AVX2
+// AVX2 version of accumulateForces(), every array must be 32-byte aligned
+AVX2_TARGET void accumulateForcesAvx2(const std::vector<glm::vec4> &sources, float softening2, const float *x, const float *y, const float *z,
+                                      float *sumX, float *sumY, float *sumZ)
+{
+    __m256 bx = _mm256_load_ps(x), by = _mm256_load_ps(y), bz = _mm256_load_ps(z);
+    __m256 accX = _mm256_load_ps(sumX), accY = _mm256_load_ps(sumY), accZ = _mm256_load_ps(sumZ);
+    __m256 eps2 = _mm256_set1_ps(softening2);
+    for (const glm::vec4 &source : sources)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_set1_ps(source.x), bx);
+        __m256 dy = _mm256_sub_ps(_mm256_set1_ps(source.y), by);
+        __m256 dz = _mm256_sub_ps(_mm256_set1_ps(source.z), bz);
+        __m256 r2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_add_ps(_mm256_mul_ps(dz, dz), eps2));
+        __m256 f = _mm256_div_ps(_mm256_set1_ps(source.w), _mm256_mul_ps(r2, _mm256_sqrt_ps(r2)));
+        accX = _mm256_add_ps(accX, _mm256_mul_ps(dx, f));
+        accY = _mm256_add_ps(accY, _mm256_mul_ps(dy, f));
+        accZ = _mm256_add_ps(accZ, _mm256_mul_ps(dz, f));
+    }
+    _mm256_store_ps(sumX, accX);
+    _mm256_store_ps(sumY, accY);
+    _mm256_store_ps(sumZ, accZ);
+}
+#endif
+
+// Gravitational N-body motion on a Barnes-Hut octree.
+// step() advances one fixed timestep with kick-drift-kick leapfrog, which is symplectic,
+// so orbits keep their energy over long runs instead of spiralling like with Euler.
+class NBodySystem
+{
+public:
+    float gravity = 1.0f;    // G in scene units
+    float timestep = 0.01f;  // Seconds of simulated time per step
+    float theta = 0.7f;      // Opening angle, nodes with size / distance below it are treated as a point mass
+    float softening = 0.01f; // Plummer softening length, keeps close encounters finite
+
+    size_t count = 0;
+    std::vector<float> px, py, pz;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> ax, ay, az;
+    std::vector<float> mass, scale;
+    std::vector<int> node; // TransformHierarchy node of each body
+
+    int add(const glm::vec3 &position, const glm::vec3 &velocity, float bodyMass, float bodyScale, int hierarchyNode)
+    {
+        px.push_back(position.x);
+        py.push_back(position.y);
+        pz.push_back(position.z);
+        vx.push_back(velocity.x);
+        vy.push_back(velocity.y);
+        vz.push_back(velocity.z);
+        ax.push_back(0.0f);
+        ay.push_back(0.0f);
+        az.push_back(0.0f);
+        mass.push_back(bodyMass);
+        scale.push_back(bodyScale);
+        node.push_back(hierarchyNode);
+        accelerationsValid = false;
+        return static_cast<int>(count++);
+    }
+
+    void step()
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (!accelerationsValid)
+        {
+            computeAccelerations();
+        }
+
+        float halfStep = 0.5f * timestep;
+        for (size_t i = 0; i < count; ++i)
+        {
+            vx[i] += ax[i] * halfStep;
+            vy[i] += ay[i] * halfStep;
+            vz[i] += az[i] * halfStep;
+            px[i] += vx[i] * timestep;
+            py[i] += vy[i] * timestep;
+            pz[i] += vz[i] * timestep;
+        }
+
+        computeAccelerations();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            vx[i] += ax[i] * halfStep;
+            vy[i] += ay[i] * halfStep;
+            vz[i] += az[i] * halfStep;
+        }
+    }
+
+    glm::mat4 matrix(size_t i) const
+    {
+        glm::mat4 m = glm::scale(glm::mat4(1.0f), glm::vec3(scale[i]));
+        m[3] = glm::vec4(px[i], py[i], pz[i], 1.0f);
+        return m;
+    }
+
+    const std::vector<OctreeNode> &tree() const
+    {
+        return nodes;
+    }
+
+private:
+    std::vector<OctreeNode> nodes;                   // Root at 0
+    std::vector<std::pair<uint64_t, int>> sorted;    // (Morton code, body) sorted by code
+    std::vector<glm::vec4> sortedBodies;             // Position and mass in Morton order, what the leaves read
+    bool accelerationsValid = false;
+
+    static uint64_t spreadBits(uint64_t v)
+    {
+        // Inserts two zero bits between each of the low 21 bits
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffff;
+        v = (v | v << 16) & 0x1f0000ff0000ff;
+        v = (v | v << 8) & 0x100f00f00f00f00f;
+        v = (v | v << 4) & 0x10c30c30c30c30c3;
+        v = (v | v << 2) & 0x1249249249249249;
+        return v;
+    }
+
+    int octant(int index, int level) const
+    {
+        return static_cast<int>(sorted[index].first >> (3 * (NBODY_MORTON_BITS - 1 - level))) & 7;
+    }
+
+    // Builds the subtree over sorted[begin, end), whose codes share their top `level` octants, into out.
+    // Returns its id in out; next ids are local to out
+    int buildNode(int begin, int end, int level, float size, std::vector<OctreeNode> &out) const
+    {
+        int id = static_cast<int>(out.size());
+        out.push_back(OctreeNode{});
+        OctreeNode node{};
+        node.size = size;
+
+        if (end - begin <= NBODY_LEAF_SIZE || level == NBODY_MORTON_BITS)
+        {
+            node.first = begin;
+            node.count = end - begin;
+            glm::vec3 weighted(0.0f);
+            for (int k = begin; k < end; ++k)
+            {
+                weighted += glm::vec3(sortedBodies[k]) * sortedBodies[k].w;
+                node.mass += sortedBodies[k].w;
+            }
+            node.centerOfMass = node.mass > 0.0f ? weighted / node.mass : glm::vec3(sortedBodies[begin]);
+            node.next = id + 1;
+            out[id] = node;
+            return id;
+        }
+
+        glm::vec3 weighted(0.0f);
+        int childBegin = begin;
+        for (int o = 0; o < 8; ++o)
+        {
+            // Codes are sorted, so each octant is a contiguous run
+            int childEnd = childBegin;
+            while (childEnd < end && octant(childEnd, level) == o)
+            {
+                ++childEnd;
+            }
+            if (childEnd > childBegin)
+            {
+                int child = buildNode(childBegin, childEnd, level + 1, size * 0.5f, out);
+                weighted += out[child].centerOfMass * out[child].mass;
+                node.mass += out[child].mass;
+            }
+            childBegin = childEnd;
+        }
+        node.centerOfMass = node.mass > 0.0f ? weighted / node.mass : out[id + 1].centerOfMass;
+        node.next = static_cast<int>(out.size());
+        out[id] = node;
+        return id;
+    }
+
+    void buildTree()
+    {
+        glm::vec3 lower(px[0], py[0], pz[0]), upper = lower;
+        for (size_t i = 1; i < count; ++i)
+        {
+            lower = glm::min(lower, glm::vec3(px[i], py[i], pz[i]));
+            upper = glm::max(upper, glm::vec3(px[i], py[i], pz[i]));
+        }
+        float size = std::max(glm::max(upper.x - lower.x, upper.y - lower.y), upper.z - lower.z) * 1.0001f + 1e-6f;
+        float cells = static_cast<float>((1 << NBODY_MORTON_BITS) - 1);
+
+        sorted.resize(count);
+        int chunks = static_cast<int>((count + NBODY_CHUNK - 1) / NBODY_CHUNK);
+        parallelRows(chunks, [&](int chunk)
+                     {
+            size_t end = std::min(count, (chunk + 1) * NBODY_CHUNK);
+            for (size_t i = chunk * NBODY_CHUNK; i < end; ++i)
+            {
+                glm::vec3 cell = (glm::vec3(px[i], py[i], pz[i]) - lower) / size * cells;
+                uint64_t code = spreadBits(static_cast<uint64_t>(cell.x)) << 2 |
+                                spreadBits(static_cast<uint64_t>(cell.y)) << 1 |
+                                spreadBits(static_cast<uint64_t>(cell.z));
+                sorted[i] = {code, static_cast<int>(i)};
+            } });
+        std::sort(sorted.begin(), sorted.end());
+
+        sortedBodies.resize(count);
+        for (size_t k = 0; k < count; ++k)
+        {
+            int body = sorted[k].second;
+            sortedBodies[k] = glm::vec4(px[body], py[body], pz[body], mass[body]);
+        }
+
+        // The eight octants of the root are built concurrently into their own arrays, then spliced
+        // after the root with their next ids shifted
+        std::array<std::vector<OctreeNode>, 8> subtrees;
+        std::array<int, 9> bounds;
+        bounds[0] = 0;
+        for (int o = 0; o < 8; ++o)
+        {
+            bounds[o + 1] = bounds[o];
+            while (bounds[o + 1] < static_cast<int>(count) && octant(bounds[o + 1], 0) == o)
+            {
+                ++bounds[o + 1];
+            }
+        }
+        parallelRows(8, [&](int o)
+                     {
+            if (bounds[o + 1] > bounds[o])
+            {
+                subtrees[o].reserve(2 * (bounds[o + 1] - bounds[o]) / NBODY_LEAF_SIZE + 1);
+                buildNode(bounds[o], bounds[o + 1], 1, size * 0.5f, subtrees[o]);
+            } });
+
+        nodes.clear();
+        OctreeNode root{};
+        root.size = size;
+        nodes.push_back(root);
+
+        glm::vec3 weighted(0.0f);
+        for (int o = 0; o < 8; ++o)
+        {
+            if (subtrees[o].empty())
+            {
+                continue;
+            }
+            int offset = static_cast<int>(nodes.size());
+            for (OctreeNode n : subtrees[o])
+            {
+                n.next += offset;
+                nodes.push_back(n);
+            }
+            weighted += nodes[offset].centerOfMass * nodes[offset].mass;
+            nodes[0].mass += nodes[offset].mass;
+        }
+        nodes[0].centerOfMass = nodes[0].mass > 0.0f ? weighted / nodes[0].mass : glm::vec3(0.0f);
+        nodes[0].next = static_cast<int>(nodes.size());
+    }
+
+    // Forces are evaluated per group of consecutive bodies in Morton order, which are close in space:
+    // one tree walk for the group builds a list of point masses (far nodes and near bodies),
+    // then every body of the group sums that list, one body per lane
+    void computeAccelerations()
+    {
+        buildTree();
+
+        float openingScale = 1.0f / theta;
+        // Keeps the zero-distance self term finite, it then contributes d * f = 0
+        float softening2 = std::max(softening * softening, 1e-12f);
+        size_t groups = (count + NBODY_LEAF_SIZE - 1) / NBODY_LEAF_SIZE;
+        size_t groupChunk = NBODY_CHUNK / NBODY_LEAF_SIZE;
+        int chunks = static_cast<int>((groups + groupChunk - 1) / groupChunk);
+        parallelRows(chunks, [&](int chunk)
+                     {
+            std::vector<glm::vec4> sources;
+            size_t end = std::min(groups, (chunk + 1) * groupChunk);
+
+            for (size_t g = chunk * groupChunk; g < end; ++g)
+            {
+                int first = static_cast<int>(g * NBODY_LEAF_SIZE);
+                int groupCount = std::min(NBODY_LEAF_SIZE, static_cast<int>(count) - first);
+
+                // Bounding sphere of the group, a node is far enough only if it is far from every body in it
+                glm::vec3 center(0.0f);
+                for (int b = first; b < first + groupCount; ++b)
+                {
+                    center += glm::vec3(sortedBodies[b]);
+                }
+                center /= static_cast<float>(groupCount);
+                float groupRadius = 0.0f;
+                for (int b = first; b < first + groupCount; ++b)
+                {
+                    groupRadius = std::max(groupRadius, glm::length(glm::vec3(sortedBodies[b]) - center));
+                }
+
+                // Depth-first walk without a stack: skipping a node jumps past its subtree, opening it
+                // steps into its first child
+                sources.clear();
+                int last = static_cast<int>(nodes.size());
+                for (int id = 0; id < last;)
+                {
+                    const OctreeNode &n = nodes[id];
+                    if (n.count > 0)
+                    {
+                        sources.insert(sources.end(), sortedBodies.begin() + n.first, sortedBodies.begin() + n.first + n.count);
+                        id = n.next;
+                        continue;
+                    }
+
+                    // size < theta * (distance - groupRadius), squared so the walk needs no square root
+                    glm::vec3 offset = n.centerOfMass - center;
+                    float reach = n.size * openingScale + groupRadius;
+                    if (glm::dot(offset, offset) > reach * reach)
+                    {
+                        sources.push_back(glm::vec4(n.centerOfMass, n.mass));
+                        id = n.next;
+                        continue;
+                    }
+                    ++id;
+                }
+
+                // Unused lanes repeat the first body and are discarded
+                alignas(32) float x[NBODY_LEAF_SIZE], y[NBODY_LEAF_SIZE], z[NBODY_LEAF_SIZE];
+                alignas(32) float sumX[NBODY_LEAF_SIZE] = {}, sumY[NBODY_LEAF_SIZE] = {}, sumZ[NBODY_LEAF_SIZE] = {};
+                for (int lane = 0; lane < NBODY_LEAF_SIZE; ++lane)
+                {
+                    const glm::vec4 &body = sortedBodies[first + (lane < groupCount ? lane : 0)];
+                    x[lane] = body.x;
+                    y[lane] = body.y;
+                    z[lane] = body.z;
+                }
+
+#if SIMD_AVX2
+                if (hasAvx2())
+                {
+                    accumulateForcesAvx2(sources, softening2, x, y, z, sumX, sumY, sumZ);
+                }
+                else
+#endif
+                {
+                    accumulateForces(sources, softening2, x, y, z, sumX, sumY, sumZ);
+                }
+
+                for (int lane = 0; lane < groupCount; ++lane)
+                {
+                    int i = sorted[first + lane].second;
+                    ax[i] = gravity * sumX[lane];
+                    ay[i] = gravity * sumY[lane];
+                    az[i] = gravity * sumZ[lane];
+                }
+            } });
+
+        accelerationsValid = true;
+    }
+};
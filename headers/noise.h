@@ -1,12 +1,173 @@
 #pragma once
 #include "./FastNoise.h"
+#include "noisekernel.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 constexpr int NOISE_WIDTH = 512;
 constexpr int NOISE_HEIGHT = 512;
+constexpr int NOISE_DEPTH = 64;          // Side of the cubic 3D table
+constexpr float NOISE_CELL_2D = 32.0f;   // Texels per noise lattice cell in the 2D table
+constexpr float NOISE_CELL_3D = 8.0f;    // Texels per noise lattice cell in the 3D table
+constexpr float NOISE_TABLE_FREQUENCY = 0.01f; // Same default frequency as FastNoiseLite
 
-FastNoiseLite noise;
+static_assert((NOISE_WIDTH & (NOISE_WIDTH - 1)) == 0 && (NOISE_HEIGHT & (NOISE_HEIGHT - 1)) == 0, "noise tables wrap with a bit mask");
+static_assert((NOISE_DEPTH & (NOISE_DEPTH - 1)) == 0, "noise tables wrap with a bit mask");
+
+// Octave settings of one shader layer, same meaning as FastNoiseLite's fractal octaves, lacunarity and gain
+struct NoiseOctaves {
+  int octaves = 3;
+  float lacunarity = 2.0f;
+  float gain = 0.5f;
+};
+
+// Precomputed tileable Perlin noise sampled with bilinear / trilinear filtering.
+// A cheap approximate stand-in for GetNoise at the default frequency: the same gradient set, quintic fade and
+// output scale as FastNoiseLite's Perlin, so the same feature size and range, but a different pattern.
+// Tiling comes from hashing lattice corners modulo the table period, so every texel keeps the full contrast.
+// Shaders opt in per layer where exact FastNoise output does not matter.
+class NoiseTable {
+public:
+  void build() {
+    table2D.resize(NOISE_WIDTH * NOISE_HEIGHT);
+    table3D.resize(NOISE_DEPTH * NOISE_DEPTH * NOISE_DEPTH);
+
+    const int period2DX = static_cast<int>(NOISE_WIDTH / NOISE_CELL_2D);
+    const int period2DY = static_cast<int>(NOISE_HEIGHT / NOISE_CELL_2D);
+    const int period3D = static_cast<int>(NOISE_DEPTH / NOISE_CELL_3D);
+
+    parallelRows(NOISE_HEIGHT, [&](int y) {
+      for (int x = 0; x < NOISE_WIDTH; ++x) {
+        table2D[y * NOISE_WIDTH + x] = periodicPerlin2D(x / NOISE_CELL_2D, y / NOISE_CELL_2D, period2DX, period2DY);
+      }
+    });
+
+    parallelRows(NOISE_DEPTH * NOISE_DEPTH, [&](int row) {
+      int z = row / NOISE_DEPTH;
+      int y = row % NOISE_DEPTH;
+      for (int x = 0; x < NOISE_DEPTH; ++x) {
+        table3D[row * NOISE_DEPTH + x] = periodicPerlin3D(x / NOISE_CELL_3D, y / NOISE_CELL_3D, z / NOISE_CELL_3D, period3D);
+      }
+    });
+  }
+
+  // Approximate 2D noise at the same input scale as GetNoise(x, y)
+  float sample(float x, float y) const {
+    float fx = x * NOISE_TABLE_FREQUENCY * NOISE_CELL_2D;
+    float fy = y * NOISE_TABLE_FREQUENCY * NOISE_CELL_2D;
+    int ix = static_cast<int>(std::floor(fx));
+    int iy = static_cast<int>(std::floor(fy));
+    float tx = fx - ix, ty = fy - iy;
+
+    int x0 = ix & (NOISE_WIDTH - 1), x1 = (ix + 1) & (NOISE_WIDTH - 1);
+    int y0 = iy & (NOISE_HEIGHT - 1), y1 = (iy + 1) & (NOISE_HEIGHT - 1);
+
+    float top = lerp(table2D[y0 * NOISE_WIDTH + x0], table2D[y0 * NOISE_WIDTH + x1], tx);
+    float bottom = lerp(table2D[y1 * NOISE_WIDTH + x0], table2D[y1 * NOISE_WIDTH + x1], tx);
+    return lerp(top, bottom, ty);
+  }
+
+  // Approximate 3D noise at the same input scale as GetNoise(x, y, z)
+  float sample(float x, float y, float z) const {
+    float f[3] = {x, y, z};
+    int i0[3], i1[3];
+    float t[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      float fa = f[axis] * NOISE_TABLE_FREQUENCY * NOISE_CELL_3D;
+      int ia = static_cast<int>(std::floor(fa));
+      t[axis] = fa - ia;
+      i0[axis] = ia & (NOISE_DEPTH - 1);
+      i1[axis] = (ia + 1) & (NOISE_DEPTH - 1);
+    }
+
+    auto at = [&](int ix, int iy, int iz) { return table3D[(iz * NOISE_DEPTH + iy) * NOISE_DEPTH + ix]; };
+    float c00 = lerp(at(i0[0], i0[1], i0[2]), at(i1[0], i0[1], i0[2]), t[0]);
+    float c10 = lerp(at(i0[0], i1[1], i0[2]), at(i1[0], i1[1], i0[2]), t[0]);
+    float c01 = lerp(at(i0[0], i0[1], i1[2]), at(i1[0], i0[1], i1[2]), t[0]);
+    float c11 = lerp(at(i0[0], i1[1], i1[2]), at(i1[0], i1[1], i1[2]), t[0]);
+    return lerp(lerp(c00, c10, t[1]), lerp(c01, c11, t[1]), t[2]);
+  }
+
+  // Octave sum of sample(), normalized back to -1...1 like FractalType_FBm
+  float fractal(float x, float y, const NoiseOctaves &settings) const {
+    float sum = 0.0f, amplitude = 1.0f, total = 0.0f;
+    for (int i = 0; i < settings.octaves; ++i) {
+      sum += sample(x, y) * amplitude;
+      total += amplitude;
+      x *= settings.lacunarity;
+      y *= settings.lacunarity;
+      amplitude *= settings.gain;
+    }
+    return total > 0.0f ? sum / total : 0.0f;
+  }
+
+  float fractal(float x, float y, float z, const NoiseOctaves &settings) const {
+    float sum = 0.0f, amplitude = 1.0f, total = 0.0f;
+    for (int i = 0; i < settings.octaves; ++i) {
+      sum += sample(x, y, z) * amplitude;
+      total += amplitude;
+      x *= settings.lacunarity;
+      y *= settings.lacunarity;
+      z *= settings.lacunarity;
+      amplitude *= settings.gain;
+    }
+    return total > 0.0f ? sum / total : 0.0f;
+  }
+
+private:
+  std::vector<float> table2D;
+  std::vector<float> table3D;
+
+  static float lerp(float a, float b, float t) { return a + (b - a) * t; }
+  static float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+
+  // Lattice hash with FastNoiseLite's primes, corners are wrapped to the period first
+  static unsigned hash(unsigned x, unsigned y, unsigned z = 0) {
+    unsigned h = (x * 501125321u) ^ (y * 1136930381u) ^ (z * 1720413743u);
+    h *= 0x27d4eb2du;
+    return h ^ (h >> 15);
+  }
+
+  static float periodicPerlin2D(float x, float y, int periodX, int periodY) {
+    int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+    float dx = x - x0, dy = y - y0;
+
+    // Unit gradient at one of 128 evenly spaced angles, like FastNoiseLite's 2D gradient table
+    auto corner = [&](int cx, int cy) {
+      unsigned h = hash(((x0 + cx) % periodX + periodX) % periodX, ((y0 + cy) % periodY + periodY) % periodY);
+      float angle = (h & 127) * (2.0f * 3.14159265f / 128.0f);
+      return std::cos(angle) * (dx - cx) + std::sin(angle) * (dy - cy);
+    };
+
+    float tx = fade(dx), ty = fade(dy);
+    float value = lerp(lerp(corner(0, 0), corner(1, 0), tx), lerp(corner(0, 1), corner(1, 1), tx), ty);
+    return value * 1.4247691104677813f;
+  }
+
+  static float periodicPerlin3D(float x, float y, float z, int period) {
+    int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y)), z0 = static_cast<int>(std::floor(z));
+    float dx = x - x0, dy = y - y0, dz = z - z0;
+
+    // One of the 12 cube edge directions, FastNoiseLite's 3D gradient set
+    static const int edges[12][3] = {{1, 1, 0}, {-1, 1, 0}, {1, -1, 0}, {-1, -1, 0}, {1, 0, 1}, {-1, 0, 1},
+                                     {1, 0, -1}, {-1, 0, -1}, {0, 1, 1}, {0, -1, 1}, {0, 1, -1}, {0, -1, -1}};
+    auto wrap = [&](int v) { return (v % period + period) % period; };
+    auto corner = [&](int cx, int cy, int cz) {
+      const int *g = edges[hash(wrap(x0 + cx), wrap(y0 + cy), wrap(z0 + cz)) % 12];
+      return g[0] * (dx - cx) + g[1] * (dy - cy) + g[2] * (dz - cz);
+    };
+
+    float tx = fade(dx), ty = fade(dy), tz = fade(dz);
+    float bottom = lerp(lerp(corner(0, 0, 0), corner(1, 0, 0), tx), lerp(corner(0, 1, 0), corner(1, 1, 0), tx), ty);
+    float top = lerp(lerp(corner(0, 0, 1), corner(1, 0, 1), tx), lerp(corner(0, 1, 1), corner(1, 1, 1), tx), ty);
+    return lerp(bottom, top, tz) * 0.964921414852142f;
+  }
+};
+
+NoiseTable noiseTable;
 
 void setupNoise() {
-  noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2); // Set the noise type to Perlin
-}
\ No newline at end of file
+  noiseTable.build(); // Fill the lookup tables before any shader samples them
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "FastNoise.h"
+
+// Mirrors FastNoiseLite::GetNoise with the noise type, fractal type and 3D rotation resolved at compile time.
+// Befriended by FastNoiseLite so it can call the per-type generators directly; every step matches the
+// runtime path operation for operation, so results are bit-identical.
+struct NoiseKernelAccess
+{
+    typedef FastNoiseLite::NoiseType NoiseType;
+    typedef FastNoiseLite::FractalType FractalType;
+    typedef FastNoiseLite::RotationType3D RotationType3D;
+
+    template <NoiseType Type>
+    static float single(const FastNoiseLite &g, int seed, float x, float y)
+    {
+        if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2)
+            return g.SingleSimplex(seed, x, y);
+        else if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2S)
+            return g.SingleOpenSimplex2S(seed, x, y);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Cellular)
+            return g.SingleCellular(seed, x, y);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Perlin)
+            return g.SinglePerlin(seed, x, y);
+        else if constexpr (Type == FastNoiseLite::NoiseType_ValueCubic)
+            return g.SingleValueCubic(seed, x, y);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Value)
+            return g.SingleValue(seed, x, y);
+        else
+            return 0;
+    }
+
+    template <NoiseType Type>
+    static float single(const FastNoiseLite &g, int seed, float x, float y, float z)
+    {
+        if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2)
+            return g.SingleOpenSimplex2(seed, x, y, z);
+        else if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2S)
+            return g.SingleOpenSimplex2S(seed, x, y, z);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Cellular)
+            return g.SingleCellular(seed, x, y, z);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Perlin)
+            return g.SinglePerlin(seed, x, y, z);
+        else if constexpr (Type == FastNoiseLite::NoiseType_ValueCubic)
+            return g.SingleValueCubic(seed, x, y, z);
+        else if constexpr (Type == FastNoiseLite::NoiseType_Value)
+            return g.SingleValue(seed, x, y, z);
+        else
+            return 0;
+    }
+
+    template <NoiseType Type, FractalType Fractal>
+    static float noise(const FastNoiseLite &g, float x, float y)
+    {
+        // Frequency and simplex skew, as in TransformNoiseCoordinate
+        x *= g.mFrequency;
+        y *= g.mFrequency;
+
+        if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2 || Type == FastNoiseLite::NoiseType_OpenSimplex2S)
+        {
+            const float SQRT3 = (float)1.7320508075688772935274463415059;
+            const float F2 = 0.5f * (SQRT3 - 1);
+            float t = (x + y) * F2;
+            x += t;
+            y += t;
+        }
+
+        if constexpr (Fractal == FastNoiseLite::FractalType_FBm)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = single<Type>(g, seed++, x, y);
+                sum += noise * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, FastNoiseLite::FastMin(noise + 1, 2) * 0.5f, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else if constexpr (Fractal == FastNoiseLite::FractalType_Ridged)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = FastNoiseLite::FastAbs(single<Type>(g, seed++, x, y));
+                sum += (noise * -2 + 1) * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, 1 - noise, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else if constexpr (Fractal == FastNoiseLite::FractalType_PingPong)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = FastNoiseLite::PingPong((single<Type>(g, seed++, x, y) + 1) * g.mPingPongStrength);
+                sum += (noise - 0.5f) * 2 * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, noise, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else
+        {
+            return single<Type>(g, g.mSeed, x, y);
+        }
+    }
+
+    template <NoiseType Type, FractalType Fractal, RotationType3D Rotation>
+    static float noise(const FastNoiseLite &g, float x, float y, float z)
+    {
+        x *= g.mFrequency;
+        y *= g.mFrequency;
+        z *= g.mFrequency;
+
+        // Domain rotation, as UpdateTransformType3D would select it
+        if constexpr (Rotation == FastNoiseLite::RotationType3D_ImproveXYPlanes)
+        {
+            float xy = x + y;
+            float s2 = xy * -(float)0.211324865405187;
+            z *= (float)0.577350269189626;
+            x += s2 - z;
+            y = y + s2 - z;
+            z += xy * (float)0.577350269189626;
+        }
+        else if constexpr (Rotation == FastNoiseLite::RotationType3D_ImproveXZPlanes)
+        {
+            float xz = x + z;
+            float s2 = xz * -(float)0.211324865405187;
+            y *= (float)0.577350269189626;
+            x += s2 - y;
+            z += s2 - y;
+            y += xz * (float)0.577350269189626;
+        }
+        else if constexpr (Type == FastNoiseLite::NoiseType_OpenSimplex2 || Type == FastNoiseLite::NoiseType_OpenSimplex2S)
+        {
+            const float R3 = (float)(2.0 / 3.0);
+            float r = (x + y + z) * R3; // Rotation, not skew
+            x = r - x;
+            y = r - y;
+            z = r - z;
+        }
+
+        if constexpr (Fractal == FastNoiseLite::FractalType_FBm)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = single<Type>(g, seed++, x, y, z);
+                sum += noise * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, (noise + 1) * 0.5f, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                z *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else if constexpr (Fractal == FastNoiseLite::FractalType_Ridged)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = FastNoiseLite::FastAbs(single<Type>(g, seed++, x, y, z));
+                sum += (noise * -2 + 1) * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, 1 - noise, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                z *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else if constexpr (Fractal == FastNoiseLite::FractalType_PingPong)
+        {
+            int seed = g.mSeed;
+            float sum = 0;
+            float amp = g.mFractalBounding;
+
+            for (int i = 0; i < g.mOctaves; i++)
+            {
+                float noise = FastNoiseLite::PingPong((single<Type>(g, seed++, x, y, z) + 1) * g.mPingPongStrength);
+                sum += (noise - 0.5f) * 2 * amp;
+                amp *= FastNoiseLite::Lerp(1.0f, noise, g.mWeightedStrength);
+
+                x *= g.mLacunarity;
+                y *= g.mLacunarity;
+                z *= g.mLacunarity;
+                amp *= g.mGain;
+            }
+
+            return sum;
+        }
+        else
+        {
+            return single<Type>(g, g.mSeed, x, y, z);
+        }
+    }
+};
+
+// Noise functor specialized for one configuration, built once per material and shared by every fragment.
+// Frequency, octaves and cellular options are still set at runtime through settings().
+template <FastNoiseLite::NoiseType Type,
+          FastNoiseLite::FractalType Fractal = FastNoiseLite::FractalType_None,
+          FastNoiseLite::RotationType3D Rotation = FastNoiseLite::RotationType3D_None>
+class Noise
+{
+public:
+    explicit Noise(int seed = 1337) : generator(seed)
+    {
+        generator.SetNoiseType(Type);
+        generator.SetFractalType(Fractal);
+        generator.SetRotationType3D(Rotation);
+    }
+
+    FastNoiseLite &settings()
+    {
+        return generator;
+    }
+
+    float operator()(float x, float y) const
+    {
+        return NoiseKernelAccess::noise<Type, Fractal>(generator, x, y);
+    }
+
+    float operator()(float x, float y, float z) const
+    {
+        return NoiseKernelAccess::noise<Type, Fractal, Rotation>(generator, x, y, z);
+    }
+
+private:
+    FastNoiseLite generator;
+};
+
+typedef Noise<FastNoiseLite::NoiseType_Perlin> PerlinNoise;
+typedef Noise<FastNoiseLite::NoiseType_Cellular> CellularNoise;
+typedef Noise<FastNoiseLite::NoiseType_OpenSimplex2> SimplexNoise;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include "debugview.h"
+
+// Command line options
+struct Options
+{
+    std::string scenePath = "../scenes/solar.scene";
+    bool headless = false;  // Render into the framebuffer only, no SDL window or video subsystem
+    int frames = 0;         // Frames to render before quitting, 0 to run until the window is closed
+    std::string cameraPath; // Camera keyframes replacing the keyboard controls, see camerapath.h
+    std::string outputDir;  // Directory receiving every rendered frame as PPM, empty to write nothing
+    std::string videoPath;  // Y4M stream receiving every rendered frame, empty to write nothing
+    std::string profileCsv; // Per-stage frame times, one row per frame, see profiler.h
+    bool hud = false;       // Start with the frame time graph shown, H toggles it
+    std::string tracePath;  // Chrome trace-event JSON of frames, stages and jobs, empty disables tracing
+    bool perfCounters = false; // Hardware counters per stage and per shader, see perfcounters.h
+    std::string recordInput;   // Writes the camera input of every frame, see input.h
+    std::string replayInput;   // Drives the camera from a recording instead of the keyboard
+    DebugView debugView = VIEW_FINAL; // Heatmap replacing the final colors, V cycles through them
+    int textureBudget = 0;            // MiB of streamed virtual texture tiles, 0 keeps VT_DEFAULT_BUDGET
+};
+
+constexpr int HEADLESS_DEFAULT_FRAMES = 300;
+
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --scene <file>        scene description (default ../scenes/solar.scene)\n"
+              << "  --headless            render offscreen, without a window\n"
+              << "  --frames <n>          quit after n frames (headless default " << HEADLESS_DEFAULT_FRAMES << ")\n"
+              << "  --camera-path <file>  fly the camera along keyframes\n"
+              << "  --output <dir>        write every frame to <dir> as PPM\n"
+              << "  --video <file>        write every frame to a Y4M stream\n"
+              << "  --profile-csv <file>  write per-stage frame times as CSV\n"
+              << "  --hud                 show the frame time graph (toggle with H)\n"
+              << "  --trace <file>        record a Chrome trace-event timeline\n"
+              << "  --perf-counters       report cycles, IPC and misses per stage and shader\n"
+              << "  --record-input <file> record camera input, one simulation step per frame\n"
+              << "  --replay-input <file> replay recorded input, quits after its last event\n"
+              << "  --debug-view <view>   final, overdraw, cost or model (cycle with V)\n"
+              << "  --texture-budget <n>  MiB of streamed planet texture tiles (default 64)\n"
+              << "  --help                show this message" << std::endl;
+}
+
+// Options followed by a value
+bool takesValue(const std::string &arg)
+{
+    for (const char *name : {"--scene", "--frames", "--camera-path", "--output", "--video", "--profile-csv", "--trace",
+                             "--record-input", "--replay-input", "--debug-view", "--texture-budget"})
+    {
+        if (arg == name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless")
+        {
+            options.headless = true;
+        }
+        else if (arg == "--perf-counters")
+        {
+            options.perfCounters = true;
+        }
+        else if (arg == "--hud")
+        {
+            options.hud = true;
+        }
+        else if (arg == "--help")
+        {
+            printUsage(argv[0]);
+            std::exit(0);
+        }
+        else if (takesValue(arg) && !hasValue)
+        {
+            std::cerr << "Error: " << arg << " expects a value" << std::endl;
+            return false;
+        }
+        else if (arg == "--scene")
+        {
+            options.scenePath = argv[++i];
+        }
+        else if (arg == "--frames")
+        {
+            options.frames = std::atoi(argv[++i]);
+            if (options.frames <= 0)
+            {
+                std::cerr << "Error: --frames expects a positive count" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--camera-path")
+        {
+            options.cameraPath = argv[++i];
+        }
+        else if (arg == "--output")
+        {
+            options.outputDir = argv[++i];
+        }
+        else if (arg == "--video")
+        {
+            options.videoPath = argv[++i];
+        }
+        else if (arg == "--profile-csv")
+        {
+            options.profileCsv = argv[++i];
+        }
+        else if (arg == "--trace")
+        {
+            options.tracePath = argv[++i];
+        }
+        else if (arg == "--record-input")
+        {
+            options.recordInput = argv[++i];
+        }
+        else if (arg == "--replay-input")
+        {
+            options.replayInput = argv[++i];
+        }
+        else if (arg == "--debug-view")
+        {
+            std::string view = argv[++i];
+            auto name = std::find(std::begin(debugViewNames), std::end(debugViewNames), view);
+            if (name == std::end(debugViewNames))
+            {
+                std::cerr << "Error: unknown debug view " << view << std::endl;
+                return false;
+            }
+            options.debugView = static_cast<DebugView>(name - std::begin(debugViewNames));
+        }
+        else if (arg == "--texture-budget")
+        {
+            options.textureBudget = std::atoi(argv[++i]);
+            if (options.textureBudget <= 0)
+            {
+                std::cerr << "Error: --texture-budget expects a positive size in MiB" << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (!options.outputDir.empty() && !options.videoPath.empty())
+    {
+        std::cerr << "Error: --output and --video cannot be combined" << std::endl;
+        return false;
+    }
+
+    if (!options.recordInput.empty() && (!options.replayInput.empty() || options.headless))
+    {
+        std::cerr << "Error: --record-input needs live input, without --replay-input or --headless" << std::endl;
+        return false;
+    }
+
+    if (options.headless && options.frames == 0 && options.replayInput.empty())
+    {
+        options.frames = HEADLESS_DEFAULT_FRAMES;
+    }
+    return true;
+}
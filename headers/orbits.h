@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "simd.h"
+
+constexpr size_t ORBIT_BATCH = 8; // Bodies per SIMD batch, one AVX2 register of floats
+
+// Simulation state of every orbiting body as structure-of-arrays, padded to a whole number of batches.
+// Angles are kept as unit rotors (cos, sin) advanced by a per-body step rotor, so the per-step
+// update is only multiplies and adds, no trigonometry.
+struct OrbitArrays
+{
+    size_t count = 0;
+    std::vector<float> radius, scale;
+    std::vector<float> orbitCos, orbitSin, orbitStepCos, orbitStepSin; // Orbit angle in the XZ plane
+    std::vector<float> spinCos, spinSin, spinStepCos, spinStepSin;     // Spin about the Y axis
+    std::vector<glm::mat4> matrices;                                    // Model matrix of each body, written by updateOrbits()
+
+    // Orbit phase and speed in radians (per step), spin phase and speed in degrees (per step).
+    // Returns the body index
+    int push_back(float orbitRadius, float orbitPhase, float orbitSpeed, float spinPhase, float spinSpeed, float bodyScale)
+    {
+        size_t padded = (count + ORBIT_BATCH) / ORBIT_BATCH * ORBIT_BATCH;
+        if (padded > radius.size())
+        {
+            // Padding lanes are identity rotors so the batched update keeps them finite
+            for (auto *lanes : {&radius, &scale, &orbitSin, &orbitStepSin, &spinSin, &spinStepSin})
+            {
+                lanes->resize(padded, 0.0f);
+            }
+            for (auto *lanes : {&orbitCos, &orbitStepCos, &spinCos, &spinStepCos})
+            {
+                lanes->resize(padded, 1.0f);
+            }
+        }
+
+        radius[count] = orbitRadius;
+        scale[count] = bodyScale;
+        orbitCos[count] = std::cos(orbitPhase);
+        orbitSin[count] = std::sin(orbitPhase);
+        orbitStepCos[count] = std::cos(orbitSpeed);
+        orbitStepSin[count] = std::sin(orbitSpeed);
+        spinCos[count] = std::cos(glm::radians(spinPhase));
+        spinSin[count] = std::sin(glm::radians(spinPhase));
+        spinStepCos[count] = std::cos(glm::radians(spinSpeed));
+        spinStepSin[count] = std::sin(glm::radians(spinSpeed));
+
+        // Only the XZ entries change with the angles, the rest is written once here
+        matrices.push_back(glm::mat4(1.0f));
+        matrices.back()[1][1] = bodyScale;
+        return static_cast<int>(count++);
+    }
+};
+
+// Rotates ORBIT_BATCH rotors (c, s) by (dc, ds) and pulls them back onto the unit circle with one Newton step,
+// otherwise rounding makes the orbits spiral after a few thousand steps
+void rotateBatch(float *c, float *s, const float *dc, const float *ds)
+{
+    // Same math lane by lane, simple enough for the compiler to vectorize
+    for (size_t i = 0; i < ORBIT_BATCH; ++i)
+    {
+        float nc = c[i] * dc[i] - s[i] * ds[i];
+        float ns = s[i] * dc[i] + c[i] * ds[i];
+        float k = 1.5f - 0.5f * (nc * nc + ns * ns);
+        c[i] = nc * k;
+        s[i] = ns * k;
+    }
+}
+
+#if SIMD_AVX2
+AVX2_TARGET void rotateBatchAvx2(float *c, float *s, const float *dc, const float *ds)
+{
+    __m256 vc = _mm256_loadu_ps(c), vs = _mm256_loadu_ps(s);
+    __m256 vdc = _mm256_loadu_ps(dc), vds = _mm256_loadu_ps(ds);
+    __m256 nc = _mm256_sub_ps(_mm256_mul_ps(vc, vdc), _mm256_mul_ps(vs, vds));
+    __m256 ns = _mm256_add_ps(_mm256_mul_ps(vs, vdc), _mm256_mul_ps(vc, vds));
+    __m256 length2 = _mm256_add_ps(_mm256_mul_ps(nc, nc), _mm256_mul_ps(ns, ns));
+    __m256 k = _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(_mm256_set1_ps(0.5f), length2));
+    _mm256_storeu_ps(c, _mm256_mul_ps(nc, k));
+    _mm256_storeu_ps(s, _mm256_mul_ps(ns, k));
+}
+#endif
+
+// Advances every orbit and spin rotor by one step and writes translate(orbit) * rotateY(spin) * scale
+// for each body into orbits.matrices, composed in closed form instead of multiplying three glm::mat4
+void updateOrbits(OrbitArrays &orbits)
+{
+    float *oc = orbits.orbitCos.data(), *os = orbits.orbitSin.data();
+    const float *odc = orbits.orbitStepCos.data(), *ods = orbits.orbitStepSin.data();
+    float *sc = orbits.spinCos.data(), *ss = orbits.spinSin.data();
+    const float *sdc = orbits.spinStepCos.data(), *sds = orbits.spinStepSin.data();
+
+    for (size_t base = 0; base < orbits.count; base += ORBIT_BATCH)
+    {
+#if SIMD_AVX2
+        if (hasAvx2())
+        {
+            rotateBatchAvx2(oc + base, os + base, odc + base, ods + base);
+            rotateBatchAvx2(sc + base, ss + base, sdc + base, sds + base);
+        }
+        else
+#endif
+        {
+            rotateBatch(oc + base, os + base, odc + base, ods + base);
+            rotateBatch(sc + base, ss + base, sdc + base, sds + base);
+        }
+
+        // The batch is still in L1, compose its matrices before moving on
+        size_t end = std::min(base + ORBIT_BATCH, orbits.count);
+        for (size_t i = base; i < end; ++i)
+        {
+            float k = orbits.scale[i];
+            float c = sc[i] * k;
+            float s = ss[i] * k;
+            float r = orbits.radius[i];
+
+            glm::mat4 &m = orbits.matrices[i];
+            m[0].x = c;
+            m[0].z = -s;
+            m[2].x = s;
+            m[2].z = c;
+            m[3].x = r * oc[i];
+            m[3].z = r * os[i];
+        }
+    }
+}
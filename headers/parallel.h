@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "trace.h"
+
+// Persistent worker threads shared by the data-parallel loops (noise tables, N-body forces, hierarchy levels).
+// The threads are started once and sleep between jobs, so a job costs a wake-up instead of a thread
+// creation and join. The calling thread takes rows too, hardware_concurrency() - 1 workers fill the machine.
+class WorkerPool
+{
+public:
+    WorkerPool()
+    {
+        // hardware_concurrency() may report 0
+        unsigned count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            workers.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    // Threads that can take part in a job, the workers plus the caller
+    unsigned threadCount() const
+    {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // Runs body(row) for every row and returns once all are done. Rows are handed out one at a time,
+    // at most rows threads take part. Calls made from inside a row run inline
+    template <typename Body>
+    void run(int rows, Body &body)
+    {
+        if (rows <= 0)
+        {
+            return;
+        }
+        if (insideJob || rows == 1 || workers.empty())
+        {
+            TraceScope trace("parallelRows", "job", rows);
+            for (int row = 0; row < rows; ++row)
+            {
+                body(row);
+            }
+            return;
+        }
+
+        // One job at a time, callers on other threads queue up here
+        std::lock_guard<std::mutex> serial(jobMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            invoke = [](void *context, int row)
+            { (*static_cast<Body *>(context))(row); };
+            context = &body;
+            jobRows = rows;
+            nextRow = 0;
+            helpers = std::min<size_t>(workers.size(), static_cast<size_t>(rows) - 1);
+            claimed = 0;
+            active = helpers;
+            ++generation;
+        }
+        wake.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]
+                      { return active == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stopping = false;
+
+    // Current job, written under mutex before the generation changes
+    void (*invoke)(void *, int) = nullptr;
+    void *context = nullptr;
+    int jobRows = 0;
+    std::atomic<int> nextRow{0};
+    uint64_t generation = 0;
+    size_t helpers = 0; // Workers taking part in the current job
+    size_t claimed = 0; // Workers that joined it so far
+    size_t active = 0;  // Workers still running it
+
+    static inline thread_local bool insideJob = false; // Running rows, nested calls must not wait for the pool
+
+    void drain()
+    {
+        TraceScope trace("parallelRows", "job", jobRows);
+        insideJob = true;
+        for (int row = nextRow.fetch_add(1); row < jobRows; row = nextRow.fetch_add(1))
+        {
+            invoke(context, row);
+        }
+        insideJob = false;
+    }
+
+    void workerLoop()
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]
+                          { return stopping || (generation != seen && claimed < helpers); });
+                if (stopping)
+                {
+                    return;
+                }
+                seen = generation;
+                ++claimed;
+            }
+
+            // The pool starts before tracing is enabled, name the thread once it records
+            tracer.nameThread("pool worker");
+            drain();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--active == 0)
+            {
+                finished.notify_one();
+            }
+        }
+    }
+};
+
+WorkerPool workerPool;
+
+// Runs body(row) for every row, spread over the shared worker pool
+template <typename Body>
+void parallelRows(int rows, Body body)
+{
+    workerPool.run(rows, body);
+}
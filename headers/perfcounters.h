@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum HardwareCounter
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+};
+
+struct CounterSample
+{
+    std::array<uint64_t, COUNTER_COUNT> values{};
+
+    CounterSample operator-(const CounterSample &other) const
+    {
+        CounterSample difference;
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            difference.values[i] = values[i] - other.values[i];
+        }
+        return difference;
+    }
+};
+
+// Counter deltas summed over a run, items are whatever the caller processed (fragments for shaders)
+struct CounterTotals
+{
+    CounterSample counters;
+    uint64_t items = 0;
+    uint64_t samples = 0;
+
+    void add(const CounterSample &delta, uint64_t processed = 0)
+    {
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            counters.values[i] += delta.values[i];
+        }
+        items += processed;
+        ++samples;
+    }
+};
+
+// Cycles, instructions, cache misses and branch misses of the calling thread, read as one perf_event group.
+// open() fails soft: without Linux, perf support or permission (perf_event_paranoid) read() returns zeros.
+class PerfCounters
+{
+public:
+    ~PerfCounters()
+    {
+        close();
+    }
+
+    // Returns an empty string on success, the reason the counters are unavailable otherwise
+    std::string open()
+    {
+#ifdef __linux__
+        const uint64_t configs[COUNTER_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+        for (int i = 0; i < COUNTER_COUNT; ++i)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0; // The group starts with its leader
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+            if (fds[i] < 0)
+            {
+                std::string reason = std::strerror(errno);
+                close();
+                return reason;
+            }
+        }
+
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return "";
+#else
+        return "perf_event_open is Linux only";
+#endif
+    }
+
+    bool isOpen() const
+    {
+        return fds[0] >= 0;
+    }
+
+    // Running totals since open(), subtract two reads to measure a region
+    CounterSample read() const
+    {
+        CounterSample sample;
+#ifdef __linux__
+        if (isOpen())
+        {
+            uint64_t buffer[1 + COUNTER_COUNT]; // nr followed by the values in group order
+            if (::read(fds[0], buffer, sizeof(buffer)) == sizeof(buffer))
+            {
+                std::memcpy(sample.values.data(), buffer + 1, sizeof(sample.values));
+            }
+        }
+#endif
+        return sample;
+    }
+
+private:
+    int fds[COUNTER_COUNT] = {-1, -1, -1, -1};
+
+    void close()
+    {
+#ifdef __linux__
+        for (int &fd : fds)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            fd = -1;
+        }
+#endif
+    }
+};
+
+void printCounterHeader(std::ostream &out, const char *itemName)
+{
+    out << std::setw(20) << "" << std::setw(14) << "cycles" << std::setw(14) << "instructions" << std::setw(7) << "IPC"
+        << std::setw(12) << "cache miss" << std::setw(12) << "branch miss" << std::setw(12) << itemName
+        << std::setw(10) << "cyc/item" << std::setw(11) << "miss/item" << std::setw(9) << "br/item" << "\n";
+}
+
+void printCounterRow(std::ostream &out, const std::string &name, const CounterTotals &totals)
+{
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    const auto &v = totals.counters.values;
+    out << std::setw(20) << name << std::setw(14) << v[COUNTER_CYCLES] << std::setw(14) << v[COUNTER_INSTRUCTIONS]
+        << std::fixed << std::setprecision(2)
+        << std::setw(7) << (v[COUNTER_CYCLES] ? static_cast<double>(v[COUNTER_INSTRUCTIONS]) / v[COUNTER_CYCLES] : 0.0)
+        << std::setw(12) << v[COUNTER_CACHE_MISSES] << std::setw(12) << v[COUNTER_BRANCH_MISSES] << std::setw(12) << totals.items;
+    if (totals.items > 0)
+    {
+        out << std::setw(10) << static_cast<double>(v[COUNTER_CYCLES]) / totals.items
+            << std::setw(11) << static_cast<double>(v[COUNTER_CACHE_MISSES]) / totals.items
+            << std::setw(9) << static_cast<double>(v[COUNTER_BRANCH_MISSES]) / totals.items;
+    }
+    out << "\n";
+    out.flags(flags);
+    out.precision(precision);
+}
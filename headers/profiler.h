@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <glm/glm.hpp>
+#include "color.h"
+#include "framebuffer.h"
+#include "alloctracker.h"
+#include "line.h"
+#include "perfcounters.h"
+#include "trace.h"
+
+constexpr int PROFILER_HISTORY = 240;   // Frames kept for percentiles and the HUD graph
+constexpr float HUD_MS_PER_PIXEL = 0.25f; // HUD bar height scale, 60 FPS is 67 px tall
+
+// Pipeline stages timed every frame, in the order they run
+enum FrameStage
+{
+    STAGE_EVENTS,
+    STAGE_SIMULATION,
+    STAGE_STARS,
+    STAGE_VERTEX,
+    STAGE_RASTER,
+    STAGE_SHADE,
+    STAGE_PRESENT,
+    STAGE_COUNT
+};
+
+const char *stageNames[STAGE_COUNT] = {"events", "simulation", "stars", "vertex", "raster", "shade", "present"};
+
+const Color stageColors[STAGE_COUNT] = {
+    Color{128, 128, 128}, Color{80, 160, 255}, Color{200, 200, 200}, Color{255, 220, 60},
+    Color{255, 140, 0}, Color{230, 40, 40}, Color{80, 220, 80}};
+
+// Per-stage frame timing over a rolling window of frames for the title and the HUD, plus every frame of the run for the summary.
+// Stages may be timed several times per frame (once per model), the durations add up.
+class FrameProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    PerfCounters counters;                                // Main thread hardware counters, closed unless enabled
+    std::array<CounterTotals, STAGE_COUNT> stageCounters; // Summed over the run, per stage
+
+    // Render thread heap activity, only counted with ALLOCATION_TRACKING
+    std::array<AllocationDelta, STAGE_COUNT + 1> frameAllocations;  // Current frame, per stage then the whole frame
+    std::array<AllocationDelta, STAGE_COUNT + 1> totalAllocations;  // Summed over the run
+
+    FrameProfiler()
+    {
+        history.resize(PROFILER_HISTORY);
+    }
+
+    // Streams one row per frame to a CSV file, milliseconds per stage and for the whole frame
+    bool openCsv(const std::string &path)
+    {
+        csv.open(path);
+        if (!csv)
+        {
+            return false;
+        }
+        csv << "frame";
+        for (const char *name : stageNames)
+        {
+            csv << "," << name;
+        }
+        csv << ",total";
+        if (ALLOCATION_TRACKING)
+        {
+            csv << ",allocations,allocated_bytes,peak_live_bytes";
+        }
+        csv << "\n";
+        return true;
+    }
+
+    // Samples hardware counters around every stage from now on, warns and carries on without them if unavailable
+    bool enableCounters()
+    {
+        std::string reason = counters.open();
+        if (!reason.empty())
+        {
+            std::cerr << "Warning: hardware counters unavailable (" << reason << "), continuing without them" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void printCounterSummary(std::ostream &out) const
+    {
+        printCounterHeader(out, "frames");
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            CounterTotals totals = stageCounters[stage];
+            totals.items = frames;
+            printCounterRow(out, stageNames[stage], totals);
+        }
+    }
+
+    // Allocations and bytes per frame on average, and the highest live heap growth within a frame
+    void printAllocationSummary(std::ostream &out) const
+    {
+        out << std::setw(12) << "stage" << std::setw(14) << "allocs/frame" << std::setw(14) << "bytes/frame"
+            << std::setw(16) << "peak live bytes" << "\n";
+        double frameCount = std::max<uint64_t>(frames, 1);
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(1);
+        for (int stage = 0; stage <= STAGE_COUNT; ++stage)
+        {
+            const AllocationDelta &totals = totalAllocations[stage];
+            out << std::setw(12) << (stage == STAGE_COUNT ? "frame" : stageNames[stage])
+                << std::setw(14) << totals.allocations / frameCount
+                << std::setw(14) << totals.bytes / frameCount
+                << std::setw(16) << totals.peakLiveBytes << "\n";
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    void beginFrame()
+    {
+        current.fill(0.0f);
+        frameAllocations.fill(AllocationDelta());
+        frameAllocationScope.begin();
+        frameStart = Clock::now();
+    }
+
+    // Also lands on the trace timeline when tracing is enabled
+    void add(FrameStage stage, Clock::time_point start, Clock::time_point end)
+    {
+        current[stage] += std::chrono::duration<float, std::milli>(end - start).count();
+        tracer.record(stageNames[stage], "stage", start, end);
+    }
+
+    void addAllocations(FrameStage stage, const AllocationDelta &delta)
+    {
+        frameAllocations[stage].add(delta);
+    }
+
+    void endFrame()
+    {
+        current[STAGE_COUNT] = std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count();
+        history[frames % PROFILER_HISTORY] = current;
+        runHistory.push_back(current);
+
+        frameAllocations[STAGE_COUNT] = frameAllocationScope.end();
+        for (int stage = 0; stage <= STAGE_COUNT; ++stage)
+        {
+            totalAllocations[stage].add(frameAllocations[stage]);
+        }
+
+        if (csv.is_open())
+        {
+            csv << frames;
+            for (float ms : current)
+            {
+                csv << "," << ms;
+            }
+            if (ALLOCATION_TRACKING)
+            {
+                const AllocationDelta &frame = frameAllocations[STAGE_COUNT];
+                csv << "," << frame.allocations << "," << frame.bytes << "," << frame.peakLiveBytes;
+            }
+            csv << "\n";
+        }
+        ++frames;
+    }
+
+    // Latest complete frame in milliseconds, stage STAGE_COUNT is the whole frame
+    float last(int stage = STAGE_COUNT) const
+    {
+        return frames > 0 ? history[(frames - 1) % PROFILER_HISTORY][stage] : 0.0f;
+    }
+
+    // p-th percentile (0-100) in milliseconds over the rolling window
+    float percentile(float p, int stage = STAGE_COUNT) const
+    {
+        return percentileOf(history.data(), std::min<uint64_t>(frames, PROFILER_HISTORY), p, stage);
+    }
+
+    // p-th percentile (0-100) in milliseconds over every frame since the start of the run
+    float runPercentile(float p, int stage = STAGE_COUNT) const
+    {
+        return percentileOf(runHistory.data(), runHistory.size(), p, stage);
+    }
+
+    // p50 / p95 / p99 per stage over the whole run
+    void printSummary(std::ostream &out) const
+    {
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+        out << std::setw(12) << "stage" << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(10) << "p99 ms" << "\n";
+        for (int stage = 0; stage <= STAGE_COUNT; ++stage)
+        {
+            out << std::setw(12) << (stage == STAGE_COUNT ? "frame" : stageNames[stage])
+                << std::setw(10) << runPercentile(50.0f, stage)
+                << std::setw(10) << runPercentile(95.0f, stage)
+                << std::setw(10) << runPercentile(99.0f, stage) << "\n";
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    // Stacked bar per frame in the bottom left corner, newest on the right, with 60 and 30 FPS guides
+    void drawHud() const
+    {
+        const int left = 8;
+        const int bottom = 8;
+        int count = static_cast<int>(std::min<uint64_t>(frames, PROFILER_HISTORY));
+
+        for (float budget : {1000.0f / 60.0f, 1000.0f / 30.0f})
+        {
+            float y = bottom + budget / HUD_MS_PER_PIXEL;
+            drawLine(glm::vec3(left, y, 0.0f), glm::vec3(left + PROFILER_HISTORY - 1, y, 0.0f), Color{90, 90, 90});
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const std::array<float, STAGE_COUNT + 1> &sample = history[(frames - count + i) % PROFILER_HISTORY];
+            float x = static_cast<float>(left + PROFILER_HISTORY - count + i);
+            float y = static_cast<float>(bottom);
+            for (int stage = 0; stage < STAGE_COUNT; ++stage)
+            {
+                float height = sample[stage] / HUD_MS_PER_PIXEL;
+                if (height >= 1.0f)
+                {
+                    drawLine(glm::vec3(x, y, 0.0f), glm::vec3(x, y + height - 1.0f, 0.0f), stageColors[stage]);
+                }
+                y += height;
+            }
+        }
+    }
+
+private:
+    std::vector<std::array<float, STAGE_COUNT + 1>> history;    // Stage times then the frame total
+    std::vector<std::array<float, STAGE_COUNT + 1>> runHistory; // Same, for every frame of the run
+    std::array<float, STAGE_COUNT + 1> current{};
+    uint64_t frames = 0;
+    Clock::time_point frameStart;
+    AllocationScope frameAllocationScope;
+    std::ofstream csv;
+
+    static float percentileOf(const std::array<float, STAGE_COUNT + 1> *samples, size_t count, float p, int stage)
+    {
+        if (count == 0)
+        {
+            return 0.0f;
+        }
+
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            values[i] = samples[i][stage];
+        }
+        size_t rank = std::min(count - 1, static_cast<size_t>(p / 100.0f * count));
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+        return values[rank];
+    }
+
+    // Written straight into the framebuffer, the overlay is not part of the scene's depth test or pixel counts
+    static void drawLine(const glm::vec3 &from, const glm::vec3 &to, Color color)
+    {
+        for (const Fragment &fragment : line(from, to))
+        {
+            if (fragment.x < SCREEN_WIDTH && fragment.y < SCREEN_HEIGHT)
+            {
+                framebuffer[fragment.y * SCREEN_WIDTH + fragment.x] = FragColor{color, -std::numeric_limits<float>::max()};
+            }
+        }
+    }
+};
+
+FrameProfiler profiler;
+
+// Adds the time (and counters, and allocations) until stop() or the end of the scope to a stage of the current frame
+class StageTimer
+{
+public:
+    explicit StageTimer(FrameStage timedStage) : stage(timedStage)
+    {
+        if (ALLOCATION_TRACKING)
+        {
+            allocations.begin();
+        }
+        if (profiler.counters.isOpen())
+        {
+            startCounters = profiler.counters.read();
+        }
+        start = FrameProfiler::Clock::now();
+    }
+
+    ~StageTimer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (stopped)
+        {
+            return;
+        }
+        stopped = true;
+
+        profiler.add(stage, start, FrameProfiler::Clock::now());
+        if (profiler.counters.isOpen())
+        {
+            profiler.stageCounters[stage].add(profiler.counters.read() - startCounters);
+        }
+        if (ALLOCATION_TRACKING)
+        {
+            profiler.addAllocations(stage, allocations.end());
+        }
+    }
+
+private:
+    FrameStage stage;
+    bool stopped = false;
+    FrameProfiler::Clock::time_point start;
+    CounterSample startCounters;
+    AllocationScope allocations;
+};
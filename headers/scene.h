@@ -0,0 +1,401 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "bvh.h"
+#include "camera.h"
+#include "mesh.h"
+#include "hierarchy.h"
+#include "model.h"
+#include "nbody.h"
+#include "orbits.h"
+#include "shaders.h"
+#include "spatialgrid.h"
+#include "texturecache.h"
+
+// Scene files are plain text, one directive per line, '#' starts a comment:
+//
+//   mesh <name> <obj path>
+//   body <mesh> <shader> <orbitRadius> <orbitPhase> <orbitSpeed> <spinPhase> <spinSpeed> <scale> [options]
+//   belt <mesh> <shader> <count> <minRadius> <maxRadius> <minOrbitSpeed> <maxOrbitSpeed> <minScale> <maxScale> <seed> [options]
+//   ship <mesh> <shader> <scale> <depth>
+//
+// Orbit phases and speeds are in radians (per step), spins in degrees (per step), see SIMULATION_STEP.
+// Shaders are named like ShaderType (SUN, ROCKY, ...). Options:
+//   cached         shade the body through the virtual texture
+//   name=<id>      lets later bodies orbit this one
+//   parent=<id>    orbit a named body instead of the origin, in its frame (so inheriting its spin and scale)
+// Ships are attached to the camera, <depth> along z from it.
+//
+// Gravity mode, bodies moved by N-body gravity instead of fixed circular orbits:
+//   gravity <G> <timestep> <theta> <softening>
+//   cluster <mesh> <shader> <count> <x> <y> <z> <radius> <totalMass> <minScale> <maxScale> <seed> [cached]
+// A cluster is a Plummer sphere of scale <radius> with roughly virialized random velocities.
+
+struct Scene
+{
+    std::vector<Model> models;
+    OrbitArrays orbits;
+    TransformHierarchy transforms;
+    NBodySystem gravity;
+    int cameraNode = -1; // Follows the camera position, parent of the ships
+    std::vector<int> ships; // Indices in models of the ships, the only models that are not solid
+
+    // World bounding sphere per model, covering its motion over the latest step so it also bounds
+    // the interpolated position. Negative radius for models that are not solid, which are never culled
+    std::vector<glm::vec4> bounds;
+    SpatialGrid solids; // Solid bodies indexed by model
+    SceneBVH bvh;       // Models, for frustum culling
+};
+
+constexpr float CAMERA_RADIUS = 0.1f; // Keeps the near plane out of the bodies
+
+bool parseShaderType(const std::string &name, ShaderType &shader)
+{
+    static const std::map<std::string, ShaderType> names = {
+        {"ROCKY", ROCKY}, {"GAS", GAS}, {"SUN", SUN}, {"EARTH", EARTH},
+        {"MARS", MARS}, {"NEPTUNE", NEPTUNE}, {"STAR", STAR}};
+
+    auto it = names.find(name);
+    if (it == names.end())
+    {
+        return false;
+    }
+    shader = it->second;
+    return true;
+}
+
+bool loadScene(const std::string &path, Scene &scene)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Error: Failed to open the scene: " << path << std::endl;
+        return false;
+    }
+
+    std::map<std::string, std::shared_ptr<const Mesh>> meshes;
+    std::map<std::string, int> namedNodes;
+    std::map<ShaderType, int> cachedSurfaces; // One virtual texture surface per shader, shared by all its bodies
+    scene.cameraNode = scene.transforms.add(-1);
+
+    // Resolves the mesh and shader shared by every body directive
+    auto makeModel = [&](std::istringstream &iss, int lineNumber, Model &model)
+    {
+        std::string meshName, shaderName;
+        iss >> meshName >> shaderName;
+        if (!meshes.count(meshName))
+        {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": unknown mesh '" << meshName << "'" << std::endl;
+            return false;
+        }
+        if (!parseShaderType(shaderName, model.currentShader))
+        {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": unknown shader '" << shaderName << "'" << std::endl;
+            return false;
+        }
+        model.mesh = meshes[meshName];
+        return true;
+    };
+
+    // Reads the trailing options of a body or belt line
+    auto parseOptions = [&](std::istringstream &iss, int lineNumber, Model &model, std::string &name, int &parent)
+    {
+        std::string option;
+        while (iss >> option)
+        {
+            if (option == "cached")
+            {
+                auto cached = cachedSurfaces.emplace(model.currentShader, -1).first;
+                int &planet = cached->second;
+                if (planet < 0)
+                {
+                    planet = virtualTexture.addPlanet(selectShader(model.currentShader));
+                }
+                model.texturePlanet = planet;
+            }
+            else if (option.rfind("name=", 0) == 0)
+            {
+                name = option.substr(5);
+            }
+            else if (option.rfind("parent=", 0) == 0)
+            {
+                auto it = namedNodes.find(option.substr(7));
+                if (it == namedNodes.end())
+                {
+                    std::cerr << "Error: " << path << ":" << lineNumber << ": unknown parent '" << option.substr(7) << "'" << std::endl;
+                    return false;
+                }
+                parent = it->second;
+            }
+            else
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": unknown option '" << option << "'" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream iss(line);
+        std::string directive;
+        if (!(iss >> directive))
+        {
+            continue;
+        }
+
+        if (directive == "mesh")
+        {
+            std::string name, meshPath;
+            iss >> name >> meshPath;
+            std::shared_ptr<Mesh> mesh = loadMesh(meshPath);
+            if (!mesh)
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": failed to load mesh " << meshPath << std::endl;
+                return false;
+            }
+            meshes[name] = mesh;
+        }
+        else if (directive == "body")
+        {
+            Model model;
+            if (!makeModel(iss, lineNumber, model))
+            {
+                return false;
+            }
+            float radius, orbitPhase, orbitSpeed, spinPhase, spinSpeed, scale;
+            iss >> radius >> orbitPhase >> orbitSpeed >> spinPhase >> spinSpeed >> scale;
+            if (iss.fail())
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed body" << std::endl;
+                return false;
+            }
+
+            std::string name;
+            int parent = -1;
+            if (!parseOptions(iss, lineNumber, model, name, parent))
+            {
+                return false;
+            }
+
+            int orbit = scene.orbits.push_back(radius, orbitPhase, orbitSpeed, spinPhase, spinSpeed, scale);
+            model.node = scene.transforms.add(parent, glm::mat4(1.0f), orbit);
+            if (!name.empty())
+            {
+                namedNodes[name] = model.node;
+            }
+            scene.models.push_back(model);
+        }
+        else if (directive == "belt")
+        {
+            Model model;
+            if (!makeModel(iss, lineNumber, model))
+            {
+                return false;
+            }
+
+            int count;
+            unsigned seed;
+            float minRadius, maxRadius, minSpeed, maxSpeed, minScale, maxScale;
+            iss >> count >> minRadius >> maxRadius >> minSpeed >> maxSpeed >> minScale >> maxScale >> seed;
+            if (iss.fail() || count < 0)
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed belt" << std::endl;
+                return false;
+            }
+
+            std::string name;
+            int parent = -1;
+            if (!parseOptions(iss, lineNumber, model, name, parent))
+            {
+                return false;
+            }
+
+            // Seeded so the same scene file always produces the same belt
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            scene.models.reserve(scene.models.size() + count);
+            for (int i = 0; i < count; ++i)
+            {
+                float radius = glm::mix(minRadius, maxRadius, unit(rng));
+                float orbitPhase = unit(rng) * 2.0f * glm::pi<float>();
+                float orbitSpeed = glm::mix(minSpeed, maxSpeed, unit(rng));
+                float spinPhase = unit(rng) * 360.0f;
+                float spinSpeed = unit(rng) * 5.0f;
+                float scale = glm::mix(minScale, maxScale, unit(rng));
+                int orbit = scene.orbits.push_back(radius, orbitPhase, orbitSpeed, spinPhase, spinSpeed, scale);
+                model.node = scene.transforms.add(parent, glm::mat4(1.0f), orbit);
+                scene.models.push_back(model);
+            }
+        }
+        else if (directive == "gravity")
+        {
+            iss >> scene.gravity.gravity >> scene.gravity.timestep >> scene.gravity.theta >> scene.gravity.softening;
+            if (iss.fail())
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed gravity" << std::endl;
+                return false;
+            }
+        }
+        else if (directive == "cluster")
+        {
+            Model model;
+            if (!makeModel(iss, lineNumber, model))
+            {
+                return false;
+            }
+
+            int count;
+            unsigned seed;
+            glm::vec3 center;
+            float radius, totalMass, minScale, maxScale;
+            iss >> count >> center.x >> center.y >> center.z >> radius >> totalMass >> minScale >> maxScale >> seed;
+            if (iss.fail() || count <= 0)
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed cluster" << std::endl;
+                return false;
+            }
+
+            std::string name;
+            int parent = -1;
+            if (!parseOptions(iss, lineNumber, model, name, parent))
+            {
+                return false;
+            }
+
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            // Per-axis velocity dispersion of a Plummer sphere in equilibrium, sigma^2 ~ 0.098 G M / a
+            std::normal_distribution<float> velocity(0.0f, std::sqrt(0.098f * scene.gravity.gravity * totalMass / radius));
+            scene.models.reserve(scene.models.size() + count);
+            for (int i = 0; i < count; ++i)
+            {
+                // Inverse of the Plummer cumulative mass, capped so no body starts absurdly far out
+                float m = std::max(unit(rng), 1e-3f) * 0.99f;
+                float r = radius / std::sqrt(std::pow(m, -2.0f / 3.0f) - 1.0f);
+                float cosTheta = 2.0f * unit(rng) - 1.0f;
+                float phi = 2.0f * glm::pi<float>() * unit(rng);
+                float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+                glm::vec3 position = center + r * glm::vec3(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+
+                glm::vec3 v(velocity(rng), velocity(rng), velocity(rng));
+                model.node = scene.transforms.add(parent);
+                scene.gravity.add(position, v, totalMass / count, glm::mix(minScale, maxScale, unit(rng)), model.node);
+                scene.models.push_back(model);
+            }
+        }
+        else if (directive == "ship")
+        {
+            Model model;
+            if (!makeModel(iss, lineNumber, model))
+            {
+                return false;
+            }
+            float scale, depth;
+            iss >> scale >> depth;
+            if (iss.fail())
+            {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": malformed ship" << std::endl;
+                return false;
+            }
+            glm::mat4 local = glm::translate(glm::mat4(1), glm::vec3(0.0f, 0.0f, depth)) * glm::scale(glm::mat4(1), glm::vec3(scale));
+            model.node = scene.transforms.add(scene.cameraNode, local);
+            model.solid = false;
+            scene.ships.push_back(static_cast<int>(scene.models.size()));
+            scene.models.push_back(model);
+        }
+        else
+        {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": unknown directive '" << directive << "'" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// World bounding sphere of a model, assuming uniform scale
+glm::vec4 worldBounds(const Scene &scene, const Model &model)
+{
+    const glm::mat4 &world = scene.transforms.world(model.node);
+    return glm::vec4(glm::vec3(world[3]), model.mesh->boundingRadius * glm::length(glm::vec3(world[0])));
+}
+
+// Sphere around both the previous and the latest world bounding spheres of a model
+glm::vec4 sweptBounds(const Scene &scene, const Model &model)
+{
+    glm::vec4 current = worldBounds(scene, model);
+    const glm::mat4 &previous = scene.transforms.previousWorld(model.node);
+    glm::vec3 travel = glm::vec3(current) - glm::vec3(previous[3]);
+    float previousRadius = model.mesh->boundingRadius * glm::length(glm::vec3(previous[0]));
+    float length = glm::length(travel);
+    return glm::vec4(glm::vec3(current) - 0.5f * travel, 0.5f * length + std::max(current.w, previousRadius));
+}
+
+// Advances every body one simulation step and refreshes the world matrices that changed
+void updateScene(Scene &scene, const Camera &camera)
+{
+    updateOrbits(scene.orbits);
+
+    scene.gravity.step();
+    for (size_t i = 0; i < scene.gravity.count; ++i)
+    {
+        scene.transforms.setLocal(scene.gravity.node[i], scene.gravity.matrix(i));
+    }
+    scene.transforms.setLocal(scene.cameraNode, glm::translate(glm::mat4(1), camera.cameraPosition));
+    scene.transforms.update(scene.orbits);
+
+    scene.bounds.resize(scene.models.size());
+    for (size_t i = 0; i < scene.models.size(); ++i)
+    {
+        scene.bounds[i] = sweptBounds(scene, scene.models[i]);
+        if (!scene.models[i].solid)
+        {
+            scene.bounds[i].w = -1.0f;
+        }
+    }
+    scene.solids.update(scene.bounds);
+    scene.bvh.update(scene.bounds);
+}
+
+// Whether moving the camera from `from` to `to` would push it or one of its ships into a solid body
+bool cameraBlocked(const Scene &scene, const glm::vec3 &from, const glm::vec3 &to)
+{
+    if (scene.solids.overlap(to, CAMERA_RADIUS) >= 0)
+    {
+        return true;
+    }
+    for (int index : scene.ships)
+    {
+        glm::vec4 ship = worldBounds(scene, scene.models[index]);
+        if (scene.solids.overlap(glm::vec3(ship) + to - from, ship.w) >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Distance from point to the surface of the closest solid body, maxDistance if none is closer
+float nearestBodyDistance(const Scene &scene, const glm::vec3 &point, float maxDistance)
+{
+    float distance;
+    scene.solids.nearest(point, maxDistance, distance);
+    return distance;
+}
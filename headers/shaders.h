@@ -3,17 +3,44 @@
 #include <glm/geometric.hpp>
 #include <glm/glm.hpp>
 #include "FastNoise.h"
+#include "noisekernel.h"
 #include "uniforms.h"
 #include "fragment.h"
+#include "model.h"
 #include "noise.h"
 #include "print.h"
 
 static int frame = 0;
 
-Vertex vertexShader(const Vertex &vertex, const Uniforms &uniforms)
+// Noise kernels configured once and shared by every fragment, instead of a new generator per call
+const PerlinNoise perlinNoise;
+const CellularNoise cellularNoise;
+const SimplexNoise simplexNoise;
+
+constexpr float NOISE_FREQUENCY = 0.01f; // FastNoiseLite default frequency, noise cycles per unit of input
+
+// Weight of a detail layer: 1 while its cycles per pixel stay well under Nyquist, fading to 0 at 0.5
+float layerWeight(float cyclesPerUV, float footprint)
+{
+    return 1.0f - glm::smoothstep(0.25f, 0.5f, cyclesPerUV * footprint);
+}
+
+// Evaluates a noise layer only when its detail is resolvable at this footprint, fading it to its mean otherwise
+template <typename Sample>
+float lodNoise(float noiseScale, float footprint, Sample sample, float mean = 0.0f)
+{
+    float weight = layerWeight(noiseScale * NOISE_FREQUENCY, footprint);
+    if (weight <= 0.0f)
+    {
+        return mean;
+    }
+    return glm::mix(mean, sample(), weight);
+}
+
+Vertex vertexShader(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &tex, const Uniforms &uniforms)
 {
     // Apply transformations to the input vertex using the matrices from the uniforms
-    glm::vec4 clipSpaceVertex = uniforms.projection * uniforms.view * uniforms.model * glm::vec4(vertex.position, 1.0f);
+    glm::vec4 clipSpaceVertex = uniforms.projection * uniforms.view * uniforms.model * glm::vec4(position, 1.0f);
 
     // Perspective divide
     glm::vec3 ndcVertex = glm::vec3(clipSpaceVertex) / clipSpaceVertex.w;
@@ -22,18 +49,15 @@ Vertex vertexShader(const Vertex &vertex, const Uniforms &uniforms)
     glm::vec4 screenVertex = uniforms.viewport * glm::vec4(ndcVertex, 1.0f);
 
     // Transform the normal
-    glm::vec3 transformedNormal = glm::mat3(uniforms.model) * vertex.normal;
+    glm::vec3 transformedNormal = glm::mat3(uniforms.model) * normal;
     transformedNormal = glm::normalize(transformedNormal);
 
-    glm::vec3 transformedWorldPosition = glm::vec3(uniforms.model * glm::vec4(vertex.position, 1.0f));
-
-    // Return the transformed vertex as a vec3
+    // Return the transformed vertex
     return Vertex{
         glm::vec3(screenVertex),
-        transformedNormal,
-        vertex.tex,
-        transformedWorldPosition,
-        vertex.position};
+        packNormal(transformedNormal),
+        glm::vec2(tex),
+        position};
 }
 
 Fragment rockyPlanetShader(Fragment &fragment)
@@ -44,24 +68,18 @@ Fragment rockyPlanetShader(Fragment &fragment)
     glm::vec3 highlightColor = glm::vec3(0.75f, 0.70f, 0.65f); // Highlights for edges and ridges
     glm::vec3 shadowColor = glm::vec3(0.30f, 0.28f, 0.26f);    // Shadows in crevices
 
-    // Convert 3D position on sphere to 2D UV coordinates for texturing
-    glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (2.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
+    // Sphere UV interpolated from the vertices, wrapped back across the longitude seam
+    glm::vec2 uv = glm::vec2(glm::fract(fragment.uv.x), fragment.uv.y);
     uv = glm::clamp(uv, 0.0f, 1.0f);
 
-    // Setup noise generators for layered texturing
-    FastNoiseLite noiseGenerator1, noiseGenerator2;
-    noiseGenerator1.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-    noiseGenerator2.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
-
     float scale1 = 100.0f; // Large-scale features
     float scale2 = 400.0f; // Fine details
 
     // Generate noise values for texture variation
-    float noiseValue1 = noiseGenerator1.GetNoise((uv.x + 0.1f) * scale1, (uv.y + 0.1f) * scale1);
-    float noiseValue2 = noiseGenerator2.GetNoise((uv.x + 0.5f) * scale2, (uv.y + 0.5f) * scale2);
+    float noiseValue1 = lodNoise(scale1, fragment.footprint, [&]
+                                 { return perlinNoise((uv.x + 0.1f) * scale1, (uv.y + 0.1f) * scale1); });
+    float noiseValue2 = lodNoise(scale2, fragment.footprint, [&]
+                                 { return cellularNoise((uv.x + 0.5f) * scale2, (uv.y + 0.5f) * scale2); });
 
     // Normalize and adjust noise values
     noiseValue1 = (noiseValue1 + 1.0f) * 0.5f;
@@ -99,30 +117,25 @@ Fragment gasGiantShader(Fragment &fragment)
     glm::vec3 lowAltitude = glm::vec3(0.3f, 0.3f, 0.3f);  // Dark gray
     glm::vec3 stormColor = glm::vec3(0.1f, 0.1f, 0.1f);   // Very dark gray, almost black
 
-    // Convert 3D position to 2D UV coordinates
-    glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (4.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
+    // Sphere UV interpolated from the vertices, longitude squeezed into [0.25, 0.75]
+    glm::vec2 uv = glm::vec2(0.25f + 0.5f * glm::fract(fragment.uv.x), fragment.uv.y);
     uv = glm::clamp(uv, 0.0f, 1.0f);
 
-    // Initialize noise generator for atmospheric detailing
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float offsetX = 100.0f;  // X offset for noise
     float offsetY = 2000.0f; // Y offset for noise
     float scale = 800.0f;    // Scale factor for noise to control the detail level
 
     // Calculate noise value for atmospheric layers
-    float atmosphericNoise = noiseGenerator.GetNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale);
+    float atmosphericNoise = lodNoise(scale, fragment.footprint, [&]
+                                      { return perlinNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale); });
     atmosphericNoise = glm::smoothstep(0.0f, 1.0f, atmosphericNoise);
 
     // Define the base color based on atmospheric noise
     glm::vec3 baseColor = glm::mix(lowAltitude, highAltitude, atmosphericNoise);
 
     // Additional noise layer for storm effects
-    float stormNoise = noiseGenerator.GetNoise((uv.x + offsetX * 0.5f) * scale * 2, (uv.y + offsetY * 0.5f) * scale * 2);
+    float stormNoise = lodNoise(scale * 2, fragment.footprint, [&]
+                                { return perlinNoise((uv.x + offsetX * 0.5f) * scale * 2, (uv.y + offsetY * 0.5f) * scale * 2); });
     stormNoise = glm::smoothstep(0.8f, 1.0f, stormNoise); // Sharper transition to create distinct storm features
 
     // Integrate storm effects into the atmosphere
@@ -131,8 +144,11 @@ Fragment gasGiantShader(Fragment &fragment)
         baseColor = glm::mix(baseColor, stormColor, (stormNoise - 0.9f) * 10.0f);
     }
 
-    // Apply cloud-like variations using a high frequency noise layer
-    float cloudVariation = noiseGenerator.GetNoise(uv.x * scale * 3, uv.y * scale * 3);
+    // Apply cloud-like variations using a high frequency noise layer (approximate, two octaves from the noise table).
+    // Faded out by the finer octave so it never aliases
+    const NoiseOctaves cloudOctaves{2, 2.0f, 0.5f};
+    float cloudVariation = lodNoise(scale * 3 * cloudOctaves.lacunarity, fragment.footprint, [&]
+                                    { return noiseTable.fractal(uv.x * scale * 3, uv.y * scale * 3, cloudOctaves); });
     cloudVariation = glm::smoothstep(0.7f, 1.0f, cloudVariation);
     baseColor = glm::mix(baseColor, midAltitude, cloudVariation);
 
@@ -153,22 +169,16 @@ Fragment sunShader(Fragment &fragment)
     glm::vec3 darkOrange = glm::vec3(1.0f, 0.4f, 0.0f);  // Darker orange for outer regions
     glm::vec3 flareOrange = glm::vec3(1.0f, 0.3f, 0.0f); // Bright orange for flares and active areas
 
-    // Convert 3D position to 2D UV coordinates
-    glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (2.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
-
-    // Set up noise generator for dynamic surface effects
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    // Sphere UV interpolated from the vertices, wrapped back across the longitude seam
+    glm::vec2 uv = glm::vec2(glm::fract(fragment.uv.x), fragment.uv.y);
 
     float offsetX = 8000.0f; // Position offset for noise
     float offsetY = 1000.0f;
     float scale = 30000.0f; // Large scale to enhance feature visibility
 
     // Generate noise value for dynamic solar surface effects
-    float noiseValue = noiseGenerator.GetNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale);
+    float noiseValue = lodNoise(scale, fragment.footprint, [&]
+                                { return perlinNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale); });
     noiseValue = (noiseValue + 1.0f) * 0.5f; // Normalize to [0, 1]
 
     glm::vec3 baseColor = glm::mix(coreOrange, midOrange, noiseValue); // Blend between core and midrange
@@ -205,23 +215,17 @@ Fragment earthShader(Fragment &fragment)
     glm::vec3 soilBrown = glm::vec3(0.45f, 0.30f, 0.20f);   // Darker brown for soil
     glm::vec3 cumulusWhite = glm::vec3(1.0f, 1.0f, 1.0f);   // Pure white for clouds
 
-    // Convert 3D position to 2D UV coordinates
-    glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (4.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
+    // Sphere UV interpolated from the vertices, longitude squeezed into [0.25, 0.75]
+    glm::vec2 uv = glm::vec2(0.25f + 0.5f * glm::fract(fragment.uv.x), fragment.uv.y);
     uv = glm::clamp(uv, 0.0f, 1.0f);
 
-    // Initialize noise generator for terrain detailing
-    FastNoiseLite terrainNoise;
-    terrainNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-
     float offsetX = 100.0f;
     float offsetY = 200000.0f;
     float scale = 600.0f;
 
     // Calculate noise value for different terrain types
-    float noiseValue = terrainNoise.GetNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale);
+    float noiseValue = lodNoise(scale, fragment.footprint, [&]
+                                { return simplexNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale); });
     glm::vec3 baseColor;
 
     if (noiseValue < 0.4f)
@@ -252,7 +256,8 @@ Fragment earthShader(Fragment &fragment)
     }
 
     // Generate cloud overlay using higher-frequency noise
-    float cloudOverlay = terrainNoise.GetNoise((uv.x + offsetX) * scale * 0.5f, (uv.y + offsetY) * scale * 0.5f);
+    float cloudOverlay = lodNoise(scale * 0.5f, fragment.footprint, [&]
+                                  { return simplexNoise((uv.x + offsetX) * scale * 0.5f, (uv.y + offsetY) * scale * 0.5f); });
     cloudOverlay = (cloudOverlay + 1.0f) * 0.3f;
     cloudOverlay = glm::smoothstep(0.0f, 1.0f, cloudOverlay);
 
@@ -273,24 +278,18 @@ Fragment marsShader(Fragment &fragment)
     glm::vec3 orangeTint = glm::vec3(0.8f, 0.4f, 0.1f); // Orange hues for variation
     glm::vec3 lightRed = glm::vec3(0.8f, 0.3f, 0.2f);   // Lighter, dusty areas
 
-    // Convert 3D position on sphere to 2D UV
-    glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (4.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
+    // Sphere UV interpolated from the vertices, longitude squeezed into [0.25, 0.75]
+    glm::vec2 uv = glm::vec2(0.25f + 0.5f * glm::fract(fragment.uv.x), fragment.uv.y);
 
     uv = glm::clamp(uv, 0.0f, 1.0f);
 
-    // Set up the noise generator for terrain detailing
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float offsetX = 100.0f;
     float offsetY = 200.0f;
     float scale = 500.0f;
 
     // Generate the noise value for terrain variation
-    float noiseValue = noiseGenerator.GetNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale);
+    float noiseValue = lodNoise(scale, fragment.footprint, [&]
+                                { return perlinNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale); });
     glm::vec3 c;
 
     // Determine terrain colors based on noise value
@@ -332,17 +331,12 @@ Fragment neptuneShader(Fragment &fragment)
     glm::vec3 vividPurple = glm::vec3(0.7f, 0.1f, 0.7f);
     glm::vec3 polarWhite = glm::vec3(1.0f, 1.0f, 1.0f);
 
-    // Normalize position to unit sphere for UV calculation
+    // Normalize position to unit sphere for the 3D noise and ring tests
     glm::vec3 pos = glm::normalize(fragment.originalPos);
-    float u = 0.5f + atan2(pos.z, pos.x) / (2.0f * glm::pi<float>());
-    float v = 0.5f - asin(pos.y) / glm::pi<float>();
-    glm::vec2 uv = glm::vec2(u, v);
-    uv = glm::clamp(uv, 0.0f, 1.0f);
 
-    // Noise generation for atmospheric and cloud patterns
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-    float cloudNoise = noiseGenerator.GetNoise(pos.x * 400.0f, pos.y * 400.0f, pos.z * 400.0f);
+    // Noise generation for atmospheric and cloud patterns (approximate, from the 3D noise table)
+    float cloudNoise = lodNoise(400.0f * 2.0f * glm::pi<float>(), fragment.footprint, [&]
+                                { return noiseTable.sample(pos.x * 400.0f, pos.y * 400.0f, pos.z * 400.0f); });
     cloudNoise = glm::smoothstep(0.2f, 0.6f, cloudNoise);
 
     glm::vec3 baseColor = glm::mix(deepBlue, lightBlue, cloudNoise);
@@ -380,15 +374,13 @@ Fragment starShader(Fragment &fragment)
 
     glm::vec2 uv = glm::vec2(fragment.originalPos.x * 2.0 - 1.0, fragment.originalPos.y * 2.0 - 1.0);
 
-    FastNoiseLite noiseGenerator;
-    noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
-
     float offsetX = 8000.0f;
     float offsetY = 1000.0f;
     float scale = 30000.0f;
 
     // Genera el valor de ruido
-    float noiseValue = noiseGenerator.GetNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale);
+    float noiseValue = lodNoise(scale, fragment.footprint, [&]
+                                { return perlinNoise((uv.x + offsetX) * scale, (uv.y + offsetY) * scale); });
     noiseValue = (noiseValue + 1.0f) * 0.9f;
 
     // Interpola entre el color base y el color secundario basado en el valor de ruido
@@ -417,3 +409,31 @@ Fragment starShader(Fragment &fragment)
 
     return fragment;
 }
+
+// Function names, indexed by ShaderType, for reports
+const char *shaderNames[SHADER_TYPE_COUNT] = {
+    "rockyPlanetShader", "gasGiantShader", "sunShader", "earthShader", "marsShader", "neptuneShader", "starShader"};
+
+FragmentShader selectShader(ShaderType shader)
+{
+    switch (shader)
+    {
+    case ROCKY:
+        return rockyPlanetShader;
+    case GAS:
+        return gasGiantShader;
+    case SUN:
+        return sunShader;
+    case EARTH:
+        return earthShader;
+    case MARS:
+        return marsShader;
+    case NEPTUNE:
+        return neptuneShader;
+    case STAR:
+        return starShader;
+    default:
+        std::cerr << "Error: Shader no reconocido." << std::endl;
+        return nullptr;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+constexpr double SIMULATION_STEP = 1.0 / 60.0; // Seconds of real time per simulation step
+constexpr int SIMULATION_MAX_STEPS = 5;        // Steps run at most per rendered frame, the rest of the backlog is dropped
+
+// Fixed-timestep clock: the simulation advances in whole steps of SIMULATION_STEP of real time,
+// whatever the frame rate, and rendering interpolates between the last two steps
+class SimulationClock
+{
+public:
+    SimulationClock() : last(std::chrono::steady_clock::now()) {}
+
+    // Number of steps to run for the real time elapsed since the previous call
+    int advance()
+    {
+        auto now = std::chrono::steady_clock::now();
+        accumulator += std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        int steps = static_cast<int>(accumulator / SIMULATION_STEP);
+        accumulator -= steps * SIMULATION_STEP;
+        if (steps > SIMULATION_MAX_STEPS)
+        {
+            // Too slow to keep up, run slower than real time rather than spiral into ever longer frames
+            steps = SIMULATION_MAX_STEPS;
+        }
+        return steps;
+    }
+
+    // Fraction of a step elapsed since the latest one, 0 shows the previous step and 1 the latest
+    float alpha() const
+    {
+        return static_cast<float>(std::clamp(accumulator / SIMULATION_STEP, 0.0, 1.0));
+    }
+
+private:
+    std::chrono::steady_clock::time_point last;
+    double accumulator = 0.0;
+};
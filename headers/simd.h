@@ -0,0 +1,24 @@
+#pragma once
+
+// AVX2 kernels are compiled per function with a target attribute and picked at runtime with hasAvx2(),
+// so a default build runs on any x86-64 CPU. Building with -mavx2 (ENABLE_AVX2) turns the check into a constant.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SIMD_AVX2 0
+#define AVX2_TARGET
+#endif
+
+bool hasAvx2()
+{
+#if defined(__AVX2__)
+    return true;
+#elif SIMD_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "parallel.h"
+
+constexpr float SPATIAL_CELL_SCALE = 4.0f; // Cell side in mean body radii
+constexpr float SPATIAL_LOOSENESS = 0.5f; // Cells a center may drift outside its filed cell before it is moved
+constexpr int SPATIAL_MAX_RING = 64;       // Cell rings searched at most by nearest() before the linear pass
+constexpr size_t SPATIAL_CHUNK = 16384;    // Ids per task of the stay-in-cell check
+
+// Loose hashed uniform grid over bounding spheres, kept up to date incrementally: every step only the
+// spheres that drifted more than SPATIAL_LOOSENESS cells out of their filed cell are moved between the
+// per-bucket linked lists, the queries widen their search by the same margin.
+// Spheres larger than half a cell would span many cells, they are kept apart in a list scanned linearly.
+// The per-step cost is the stay-in-cell check, which reads 28 bytes per sphere: 2.8 MB for 100k spheres,
+// about half a millisecond on one core of which a third is just the memory traffic. It is split over
+// the worker pool, so it shrinks with the core count until memory bandwidth is the limit.
+class SpatialGrid
+{
+public:
+    // spheres: center and radius per id, a negative radius leaves the id out of the grid.
+    // The grid keeps a pointer to the vector and reads positions from it in the queries
+    void update(const std::vector<glm::vec4> &spheres)
+    {
+        source = &spheres;
+        if (spheres.size() != bucketOf.size())
+        {
+            reset(spheres);
+        }
+
+        // Nearly every body stays within its loose cell from one step to the next. That check is a pure
+        // streaming pass over the spheres, it runs on the worker pool and only collects the ids that left;
+        // relinking those few stays serial, in id order, so the lists do not depend on the thread count
+        size_t count = spheres.size();
+        int chunks = static_cast<int>((count + SPATIAL_CHUNK - 1) / SPATIAL_CHUNK);
+        movers.resize(chunks);
+        chunkRadius.assign(chunks, 0.0f);
+        const float halfCell = 0.5f * cellSize;
+        parallelRows(chunks, [&](int chunk)
+                     {
+            const glm::vec4 *sphereData = spheres.data();
+            const glm::vec3 *cellData = cellOf.data();
+            std::vector<int> &moved = movers[chunk];
+            moved.clear();
+            float maxRadius = 0.0f;
+            size_t end = std::min(count, (chunk + 1) * SPATIAL_CHUNK);
+            for (size_t i = chunk * SPATIAL_CHUNK; i < end; ++i)
+            {
+                // Without floor, hash or branches. Unfiled ids have a NaN cell and always fail
+                const glm::vec4 &sphere = sphereData[i];
+                const glm::vec3 &c = cellData[i];
+                float x = sphere.x * inverseCellSize - c.x;
+                float y = sphere.y * inverseCellSize - c.y;
+                float z = sphere.z * inverseCellSize - c.z;
+                const float low = -SPATIAL_LOOSENESS, high = 1.0f + SPATIAL_LOOSENESS;
+                bool stays = (x >= low) & (x < high) & (y >= low) & (y < high) & (z >= low) & (z < high) & (sphere.w <= halfCell);
+                if (stays)
+                {
+                    maxRadius = std::max(maxRadius, sphere.w);
+                }
+                else
+                {
+                    moved.push_back(static_cast<int>(i));
+                }
+            }
+            chunkRadius[chunk] = maxRadius; });
+
+        bool largeChanged = false;
+        float maxRadius = 0.0f;
+        for (int chunk = 0; chunk < chunks; ++chunk)
+        {
+            maxRadius = std::max(maxRadius, chunkRadius[chunk]);
+            for (int id : movers[chunk])
+            {
+                const glm::vec4 &sphere = spheres[id];
+                int b = NONE;
+                cellOf[id] = glm::vec3(NAN);
+                if (sphere.w > halfCell)
+                {
+                    b = LARGE;
+                }
+                else if (sphere.w >= 0.0f)
+                {
+                    glm::ivec3 filed = cell(glm::vec3(sphere));
+                    b = static_cast<int>(bucket(filed.x, filed.y, filed.z));
+                    maxRadius = std::max(maxRadius, sphere.w);
+                    cellOf[id] = glm::vec3(filed);
+                }
+                if (b == bucketOf[id])
+                {
+                    continue;
+                }
+
+                largeChanged |= b == LARGE || bucketOf[id] == LARGE;
+                unlink(id);
+                bucketOf[id] = b;
+                if (b >= 0)
+                {
+                    link(id);
+                }
+            }
+        }
+        maxSmallRadius = maxRadius;
+
+        if (largeChanged)
+        {
+            large.clear();
+            for (size_t i = 0; i < spheres.size(); ++i)
+            {
+                if (bucketOf[i] == LARGE)
+                {
+                    large.push_back(static_cast<int>(i));
+                }
+            }
+        }
+    }
+
+    // Id of a sphere intersecting the query sphere, -1 if none
+    int overlap(const glm::vec3 &center, float radius) const
+    {
+        for (int id : large)
+        {
+            if (intersects(id, center, radius))
+            {
+                return id;
+            }
+        }
+        if (head.empty())
+        {
+            return -1;
+        }
+
+        // Small spheres are filed by their center, which can sit up to maxSmallRadius outside the query
+        // and up to the looseness margin outside its filed cell
+        float reach = radius + maxSmallRadius + SPATIAL_LOOSENESS * cellSize;
+        glm::ivec3 lower = cell(center - glm::vec3(reach));
+        glm::ivec3 upper = cell(center + glm::vec3(reach));
+        for (int z = lower.z; z <= upper.z; ++z)
+        {
+            for (int y = lower.y; y <= upper.y; ++y)
+            {
+                for (int x = lower.x; x <= upper.x; ++x)
+                {
+                    for (int id = head[bucket(x, y, z)]; id >= 0; id = next[id])
+                    {
+                        if (intersects(id, center, radius))
+                        {
+                            return id;
+                        }
+                    }
+                }
+            }
+        }
+        return -1;
+    }
+
+    // Id of the sphere whose surface is closest to point, -1 if none within maxDistance.
+    // distance is negative when the point is inside
+    int nearest(const glm::vec3 &point, float maxDistance, float &distance) const
+    {
+        int best = -1;
+        distance = maxDistance;
+        for (int id : large)
+        {
+            consider(id, point, best, distance);
+        }
+        if (head.empty())
+        {
+            return best;
+        }
+
+        // Rings of cells around the point's cell; after ring k every unvisited center is at least
+        // k - 1 - SPATIAL_LOOSENESS cells away, so the search stops once that bound beats the best surface distance.
+        // Far from every body the rings would visit far more cells than there are buckets, past that
+        // point one linear pass over the filed ids is cheaper
+        glm::ivec3 origin = cell(point);
+        size_t visited = 0;
+        for (int k = 0; k <= SPATIAL_MAX_RING; ++k)
+        {
+            float reach = (k - 1 - SPATIAL_LOOSENESS) * cellSize - maxSmallRadius;
+            if (reach > distance)
+            {
+                return best;
+            }
+            size_t side = 2 * k + 1;
+            size_t ringCells = k == 0 ? 1 : side * side * side - (side - 2) * (side - 2) * (side - 2);
+            if (visited + ringCells > head.size())
+            {
+                break;
+            }
+            visited += ringCells;
+
+            for (int z = -k; z <= k; ++z)
+            {
+                for (int y = -k; y <= k; ++y)
+                {
+                    bool shell = std::abs(z) == k || std::abs(y) == k;
+                    for (int x = -k; x <= k; x += shell ? 1 : 2 * std::max(k, 1))
+                    {
+                        for (int id = head[bucket(origin.x + x, origin.y + y, origin.z + z)]; id >= 0; id = next[id])
+                        {
+                            consider(id, point, best, distance);
+                        }
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < bucketOf.size(); ++i)
+        {
+            if (bucketOf[i] >= 0)
+            {
+                consider(static_cast<int>(i), point, best, distance);
+            }
+        }
+        return best;
+    }
+
+private:
+    static constexpr int NONE = -1;  // Not in the grid
+    static constexpr int LARGE = -2; // In the large list
+
+    const std::vector<glm::vec4> *source = nullptr;
+    float cellSize = 1.0f;
+    float inverseCellSize = 1.0f;
+    float maxSmallRadius = 0.0f;
+    uint32_t mask = 0;
+    std::vector<int> head;       // First id of each bucket, -1 when empty
+    std::vector<int> next, prev; // Doubly linked bucket lists, so moving an id is O(1)
+    std::vector<int> bucketOf;   // Bucket per id, or NONE / LARGE
+    std::vector<glm::vec3> cellOf; // Integer cell coordinates per filed id, NaN for the others
+    std::vector<int> large;
+    std::vector<std::vector<int>> movers; // Per check task, ids that left their loose cell, kept to reuse the memory
+    std::vector<float> chunkRadius;       // Per check task, largest radius of the ids that stayed
+
+    // Sizes the cells and the table for a new set of spheres, every id starts unfiled
+    void reset(const std::vector<glm::vec4> &spheres)
+    {
+        float radiusSum = 0.0f;
+        size_t solid = 0;
+        for (const glm::vec4 &sphere : spheres)
+        {
+            if (sphere.w >= 0.0f)
+            {
+                radiusSum += sphere.w;
+                ++solid;
+            }
+        }
+        cellSize = std::max(SPATIAL_CELL_SCALE * radiusSum / std::max<size_t>(solid, 1), 1e-4f);
+        inverseCellSize = 1.0f / cellSize;
+
+        size_t tableSize = 1;
+        while (tableSize < solid)
+        {
+            tableSize <<= 1;
+        }
+        mask = static_cast<uint32_t>(tableSize - 1);
+        head.assign(tableSize, -1);
+        next.assign(spheres.size(), -1);
+        prev.assign(spheres.size(), -1);
+        bucketOf.assign(spheres.size(), NONE);
+        cellOf.assign(spheres.size(), glm::vec3(NAN));
+        large.clear();
+    }
+
+    void link(int id)
+    {
+        int b = bucketOf[id];
+        prev[id] = -1;
+        next[id] = head[b];
+        if (head[b] >= 0)
+        {
+            prev[head[b]] = id;
+        }
+        head[b] = id;
+    }
+
+    void unlink(int id)
+    {
+        if (bucketOf[id] < 0)
+        {
+            return;
+        }
+        if (prev[id] >= 0)
+        {
+            next[prev[id]] = next[id];
+        }
+        else
+        {
+            head[bucketOf[id]] = next[id];
+        }
+        if (next[id] >= 0)
+        {
+            prev[next[id]] = prev[id];
+        }
+    }
+
+    glm::ivec3 cell(const glm::vec3 &p) const
+    {
+        return glm::ivec3(static_cast<int>(std::floor(p.x * inverseCellSize)),
+                          static_cast<int>(std::floor(p.y * inverseCellSize)),
+                          static_cast<int>(std::floor(p.z * inverseCellSize)));
+    }
+
+    uint32_t bucket(int x, int y, int z) const
+    {
+        uint32_t h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^ static_cast<uint32_t>(z) * 83492791u;
+        return h & mask;
+    }
+
+    bool intersects(int id, const glm::vec3 &center, float radius) const
+    {
+        const glm::vec4 &sphere = (*source)[id];
+        glm::vec3 d = glm::vec3(sphere) - center;
+        float reach = sphere.w + radius;
+        return glm::dot(d, d) < reach * reach;
+    }
+
+    void consider(int id, const glm::vec3 &point, int &best, float &distance) const
+    {
+        const glm::vec4 &sphere = (*source)[id];
+        float d = glm::length(glm::vec3(sphere) - point) - sphere.w;
+        if (d < distance)
+        {
+            distance = d;
+            best = id;
+        }
+    }
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "shaders.h"
+
+// Background star field, ox and oy shift the pattern with the camera
+void renderStars(int ox, int oy)
+{
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    {
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+        {
+            float scale = 1000.0f;
+            float noiseValue = simplexNoise((x + (ox * 100.0f)) * scale, (y + oy * 100.0f) * scale);
+
+            // If the noise value is above a threshold, draw a star
+            if (noiseValue > 0.97f)
+            {
+                framebuffer[y * SCREEN_WIDTH + x] = star;
+            }
+            else
+            {
+                framebuffer[y * SCREEN_WIDTH + x] = blank;
+            }
+        }
+    }
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include "color.h"
+#include "fragment.h"
+#include "trace.h"
+
+constexpr int VT_TILE_SIZE = 64;                        // Texels per tile side
+constexpr int VT_MIP_COUNT = 7;                         // Mip 0 is 8192x4096 texels, mip 6 is 128x64
+constexpr size_t VT_DEFAULT_BUDGET = 64 * 1024 * 1024;  // Bytes of streamed tiles kept resident
+constexpr size_t VT_MAX_PENDING = 1024;                 // Oldest tile requests are dropped past this
+
+// Tiles per row and per column of an equirectangular mip level (always 2:1)
+inline int tilesX(int mip) { return 2 << (VT_MIP_COUNT - 1 - mip); }
+inline int tilesY(int mip) { return 1 << (VT_MIP_COUNT - 1 - mip); }
+
+struct VirtualTile
+{
+    std::vector<Color> texels;
+};
+
+// Lazily caches procedural shader output in fixed-size tiles keyed by (planet, mip, u-tile, v-tile).
+// Missing tiles are filled by worker threads while sampling falls back to the next coarser resident mip;
+// the coarsest mip of every planet is baked up front so a fallback always exists.
+class VirtualTextureCache
+{
+public:
+    size_t memoryBudget = VT_DEFAULT_BUDGET; // Bytes, set before start(), see --texture-budget
+
+    ~VirtualTextureCache()
+    {
+        stop();
+    }
+
+    // Registers a planet surface and bakes its coarsest mip, returns the planet id used for sampling
+    int addPlanet(FragmentShader shader)
+    {
+        int planet;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            planet = static_cast<int>(shaders.size());
+            shaders.push_back(shader);
+        }
+
+        int mip = VT_MIP_COUNT - 1;
+        for (int tv = 0; tv < tilesY(mip); ++tv)
+        {
+            for (int tu = 0; tu < tilesX(mip); ++tu)
+            {
+                std::shared_ptr<VirtualTile> tile = fillTile(shader, mip, tu, tv);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                tiles[tileKey(planet, mip, tu, tv)] = Entry{tile, lru.end(), true};
+            }
+        }
+
+        return planet;
+    }
+
+    void start(unsigned workerCount = 0)
+    {
+        if (workerCount == 0)
+        {
+            // hardware_concurrency() may report 0, keep at least one worker
+            workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        running = true;
+        for (unsigned i = 0; i < workerCount; ++i)
+        {
+            workers.emplace_back(&VirtualTextureCache::workerLoop, this);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        wake.notify_all();
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // Starts a new frame: every thread looks its cached tile up once more, which refreshes its LRU position
+    void beginFrame()
+    {
+        ++frame;
+    }
+
+    // Unlit surface color at uv, from the requested mip if resident or the closest coarser one otherwise
+    Color sample(int planet, int mip, glm::vec2 uv)
+    {
+        uv.x = glm::fract(uv.x);
+        uv.y = glm::clamp(uv.y, 0.0f, 1.0f);
+
+        // Consecutive fragments of a triangle nearly always hit the same tile, skip the lock for those.
+        // The shortcut only lasts one frame so a tile sampled all the time still moves to the LRU front
+        thread_local uint64_t lastKey = UINT64_MAX;
+        thread_local uint64_t lastFrame = UINT64_MAX;
+        thread_local std::shared_ptr<const VirtualTile> lastTile;
+        uint64_t currentFrame = frame.load(std::memory_order_relaxed);
+
+        for (int level = mip; level < VT_MIP_COUNT; ++level)
+        {
+            int width = tilesX(level) * VT_TILE_SIZE;
+            int height = tilesY(level) * VT_TILE_SIZE;
+            int x = std::min(static_cast<int>(uv.x * width), width - 1);
+            int y = std::min(static_cast<int>(uv.y * height), height - 1);
+            uint64_t key = tileKey(planet, level, x / VT_TILE_SIZE, y / VT_TILE_SIZE);
+            int texel = (y % VT_TILE_SIZE) * VT_TILE_SIZE + (x % VT_TILE_SIZE);
+
+            if (key == lastKey && lastFrame == currentFrame)
+            {
+                return lastTile->texels[texel];
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = tiles.find(key);
+            if (it != tiles.end())
+            {
+                if (!it->second.pinned)
+                {
+                    lru.splice(lru.begin(), lru, it->second.lru);
+                }
+                if (level == mip)
+                {
+                    lastKey = key;
+                    lastFrame = currentFrame;
+                    lastTile = it->second.tile;
+                }
+                return it->second.tile->texels[texel];
+            }
+
+            if (level == mip && pending.insert(key).second)
+            {
+                requests.push_back(key);
+                if (requests.size() > VT_MAX_PENDING)
+                {
+                    pending.erase(requests.front());
+                    requests.pop_front();
+                }
+                wake.notify_one();
+            }
+        }
+
+        return Color();
+    }
+
+    size_t residentBytes()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return streamedBytes;
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const VirtualTile> tile;
+        std::list<uint64_t>::iterator lru;
+        bool pinned;
+    };
+
+    static constexpr size_t TILE_BYTES = VT_TILE_SIZE * VT_TILE_SIZE * sizeof(Color);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::thread> workers;
+    std::vector<FragmentShader> shaders;
+    std::unordered_map<uint64_t, Entry> tiles;
+    std::list<uint64_t> lru;
+    std::deque<uint64_t> requests;
+    std::unordered_set<uint64_t> pending;
+    size_t streamedBytes = 0;
+    bool running = false;
+    std::atomic<uint64_t> frame{0};
+
+    static uint64_t tileKey(int planet, int mip, int tu, int tv)
+    {
+        return (static_cast<uint64_t>(planet) << 40) | (static_cast<uint64_t>(mip) << 32) |
+               (static_cast<uint64_t>(tu) << 16) | static_cast<uint64_t>(tv);
+    }
+
+    // Evaluates the shader at every texel center of a tile, on the unit sphere and fully lit
+    static std::shared_ptr<VirtualTile> fillTile(FragmentShader shader, int mip, int tu, int tv)
+    {
+        auto tile = std::make_shared<VirtualTile>();
+        tile->texels.resize(VT_TILE_SIZE * VT_TILE_SIZE);
+
+        float width = static_cast<float>(tilesX(mip) * VT_TILE_SIZE);
+        float height = static_cast<float>(tilesY(mip) * VT_TILE_SIZE);
+
+        for (int y = 0; y < VT_TILE_SIZE; ++y)
+        {
+            for (int x = 0; x < VT_TILE_SIZE; ++x)
+            {
+                glm::vec2 uv((tu * VT_TILE_SIZE + x + 0.5f) / width, (tv * VT_TILE_SIZE + y + 0.5f) / height);
+
+                // Inverse of sphericalUV so shaders reading originalPos see the matching sphere point
+                float longitude = (uv.x - 0.5f) * 2.0f * glm::pi<float>();
+                float latitude = (0.5f - uv.y) * glm::pi<float>();
+
+                Fragment fragment{};
+                fragment.intensity = 1.0f;
+                fragment.uv = uv;
+                fragment.footprint = 1.0f / width;
+                fragment.originalPos = glm::vec3(cos(latitude) * cos(longitude), sin(latitude), cos(latitude) * sin(longitude));
+
+                tile->texels[y * VT_TILE_SIZE + x] = shader(fragment).color;
+            }
+        }
+
+        return tile;
+    }
+
+    void workerLoop()
+    {
+        tracer.nameThread("texture worker");
+        while (true)
+        {
+            uint64_t key;
+            FragmentShader shader;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return !running || !requests.empty(); });
+                if (!running)
+                {
+                    return;
+                }
+
+                // Newest requests first, they belong to what is on screen right now
+                key = requests.back();
+                requests.pop_back();
+                shader = shaders[key >> 40];
+            }
+
+            int mip = static_cast<int>((key >> 32) & 0xFF);
+            int tu = static_cast<int>((key >> 16) & 0xFFFF);
+            int tv = static_cast<int>(key & 0xFFFF);
+            std::shared_ptr<VirtualTile> tile;
+            {
+                TraceScope trace("fillTile", "job", mip);
+                tile = fillTile(shader, mip, tu, tv);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(key);
+            lru.push_front(key);
+            tiles[key] = Entry{tile, lru.begin(), false};
+            streamedBytes += TILE_BYTES;
+
+            // Evict least recently sampled tiles once over budget, pinned coarse mips are never in the list
+            while (streamedBytes > memoryBudget && lru.size() > 1)
+            {
+                tiles.erase(lru.back());
+                lru.pop_back();
+                streamedBytes -= TILE_BYTES;
+            }
+        }
+    }
+};
+
+VirtualTextureCache virtualTexture;
+
+// Mip whose texels best match the UV footprint of one pixel, finer mips would alias
+int selectMip(float footprint)
+{
+    float finest = static_cast<float>(tilesX(0) * VT_TILE_SIZE);
+    int mip = static_cast<int>(std::floor(std::log2(std::max(footprint * finest, 1.0f))));
+    return std::clamp(mip, 0, VT_MIP_COUNT - 1);
+}
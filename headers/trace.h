@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr size_t TRACE_MAX_EVENTS = 1 << 20; // Per thread, later events are counted and dropped
+
+// One complete ("X") event, name and category must be string literals
+struct TraceEvent
+{
+    const char *name;
+    const char *category;
+    int64_t start; // Microseconds since the tracer started
+    int64_t duration;
+    int64_t arg;   // Written as args.id when not negative
+};
+
+// Records timeline events into one buffer per thread, written out as Chrome trace-event JSON
+// (about://tracing, ui.perfetto.dev). Recording takes no lock, only a thread's first event does.
+// While disabled every call is a single relaxed load.
+class Tracer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void enable()
+    {
+        epoch = Clock::now();
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    bool isEnabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void record(const char *name, const char *category, Clock::time_point start, Clock::time_point end, int64_t arg = -1)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+
+        ThreadBuffer &buffer = threadBuffer();
+        if (buffer.events.size() >= TRACE_MAX_EVENTS)
+        {
+            ++buffer.dropped;
+            return;
+        }
+        buffer.events.push_back(TraceEvent{name, category, microseconds(start), microseconds(end) - microseconds(start), arg});
+    }
+
+    // Labels the calling thread's track in the viewer
+    void nameThread(const char *name)
+    {
+        if (isEnabled())
+        {
+            threadBuffer().name = name;
+        }
+    }
+
+    // Call once the threads that recorded have stopped
+    bool write(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]
+        {
+            file << (first ? "" : ",\n");
+            first = false;
+        };
+
+        for (const auto &buffer : buffers)
+        {
+            separator();
+            file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->tid
+                 << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            for (const TraceEvent &event : buffer->events)
+            {
+                separator();
+                file << "{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                     << "\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+                if (event.arg >= 0)
+                {
+                    file << ",\"args\":{\"id\":" << event.arg << "}";
+                }
+                file << "}";
+            }
+        }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    uint64_t droppedEvents()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t dropped = 0;
+        for (const auto &buffer : buffers)
+        {
+            dropped += buffer->dropped;
+        }
+        return dropped;
+    }
+
+private:
+    struct ThreadBuffer
+    {
+        int tid;
+        const char *name = "thread";
+        std::vector<TraceEvent> events;
+        uint64_t dropped = 0;
+    };
+
+    std::atomic<bool> enabled{false};
+    Clock::time_point epoch;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; // Kept after their thread exits
+
+    ThreadBuffer &threadBuffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->tid = static_cast<int>(buffers.size());
+            buffer->events.reserve(4096);
+        }
+        return *buffer;
+    }
+
+    int64_t microseconds(Clock::time_point time) const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time - epoch).count();
+    }
+};
+
+Tracer tracer;
+
+// Records the enclosing scope as one event
+class TraceScope
+{
+public:
+    TraceScope(const char *eventName, const char *eventCategory, int64_t eventArg = -1)
+        : name(eventName), category(eventCategory), arg(eventArg)
+    {
+        if (tracer.isEnabled())
+        {
+            start = Tracer::Clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (tracer.isEnabled() && start != Tracer::Clock::time_point())
+        {
+            tracer.record(name, category, start, Tracer::Clock::now(), arg);
+        }
+    }
+
+private:
+    const char *name;
+    const char *category;
+    int64_t arg;
+    Tracer::Clock::time_point start{};
+};
@@ -25,63 +25,108 @@ std::pair<float, float> barycentricCoordinates(const glm::ivec2& P, const glm::v
     );    
 }
 
-std::vector<Fragment> triangle(const Vertex& a, const Vertex& b, const Vertex& c) {
-  std::vector<Fragment> fragments;
+// Rasterizes in 2x2 pixel quads so every fragment knows how its inputs change across the screen.
+// Lanes outside the triangle still interpolate (extrapolate) their attributes as helper lanes,
+// which gives coarse dFdx/dFdy-style derivatives, but only covered lanes are emitted.
+// originalPos is only interpolated when the shader reads it.
+// Fragments are appended to any container with push_back(Fragment), a std::vector or a FragmentBatch.
+template <typename Output>
+void triangle(const Vertex& a, const Vertex& b, const Vertex& c, bool needsPosition, Output& fragments) {
   glm::vec3 A = a.position;
   glm::vec3 B = b.position;
   glm::vec3 C = c.position;
 
+  // Normals are packed per vertex, decode them once per triangle
+  glm::vec3 normalA = unpackNormal(a.normal);
+  glm::vec3 normalB = unpackNormal(b.normal);
+  glm::vec3 normalC = unpackNormal(c.normal);
+
   float minX = std::min(std::min(A.x, B.x), C.x);
   float minY = std::min(std::min(A.y, B.y), C.y);
   float maxX = std::max(std::max(A.x, B.x), C.x);
   float maxY = std::max(std::max(A.y, B.y), C.y);
 
-  // Iterate over each point in the bounding box
-  for (int y = static_cast<int>(std::ceil(minY)); y <= static_cast<int>(std::floor(maxY)); ++y) {
-    for (int x = static_cast<int>(std::ceil(minX)); x <= static_cast<int>(std::floor(maxX)); ++x) {
-      if (x < 0 || y < 0 || y > SCREEN_HEIGHT || x > SCREEN_WIDTH)
-        continue;
-        
-      glm::ivec2 P(x, y);
-      auto barycentric = barycentricCoordinates(P, A, B, C);
-      float w = 1 - barycentric.first - barycentric.second;
-      float v = barycentric.first;
-      float u = barycentric.second;
-      float epsilon = 1e-10;
-
-      if (w < epsilon || v < epsilon || u < epsilon)
-        continue;
-          
-      double z = A.z * w + B.z * v + C.z * u;
-      
-       glm::vec3 normal = glm::normalize( 
-           a.normal * w + b.normal * v + c.normal * u
-       ); 
-
-      // glm::vec3 normal = a.normal; // assume flatness
-      float intensity = glm::dot(normal, L);
-      
-      if (intensity < 0)
+  // Clip the bounding box to the screen and align its start to the quad grid
+  int startX = std::max(static_cast<int>(std::ceil(minX)), 0) & ~1;
+  int startY = std::max(static_cast<int>(std::ceil(minY)), 0) & ~1;
+  int endX = std::min(static_cast<int>(std::floor(maxX)), static_cast<int>(SCREEN_WIDTH) - 1);
+  int endY = std::min(static_cast<int>(std::floor(maxY)), static_cast<int>(SCREEN_HEIGHT) - 1);
+
+  // Iterate over each quad in the bounding box
+  for (int qy = startY; qy <= endY; qy += 2) {
+    for (int qx = startX; qx <= endX; qx += 2) {
+      // Lane order: 0 = (x, y), 1 = (x + 1, y), 2 = (x, y + 1), 3 = (x + 1, y + 1)
+      float w[4], v[4], u[4];
+      bool covered[4];
+      bool anyCovered = false;
+
+      for (int lane = 0; lane < 4; ++lane) {
+        glm::ivec2 P(qx + (lane & 1), qy + (lane >> 1));
+        auto barycentric = barycentricCoordinates(P, A, B, C);
+        w[lane] = 1 - barycentric.first - barycentric.second;
+        v[lane] = barycentric.first;
+        u[lane] = barycentric.second;
+        float epsilon = 1e-10;
+
+        covered[lane] = P.x <= endX && P.y <= endY &&
+                        w[lane] >= epsilon && v[lane] >= epsilon && u[lane] >= epsilon;
+        anyCovered = anyCovered || covered[lane];
+      }
+
+      if (!anyCovered)
         continue;
 
-      Color color = Color(255, 255, 255);
+      glm::vec2 uv[4];
+      for (int lane = 0; lane < 4; ++lane) {
+        uv[lane] = a.tex * w[lane] + b.tex * v[lane] + c.tex * u[lane];
+      }
 
+      // Coarse derivatives shared by the whole quad
+      glm::vec2 uvDx = uv[1] - uv[0];
+      glm::vec2 uvDy = uv[2] - uv[0];
+      float footprint = std::max(glm::length(uvDx), glm::length(uvDy));
 
-      glm::vec3 worldPos = a.worldPos * w + b.worldPos * v + c.worldPos * u;
-      glm::vec3 originalPos = a.originalPos * w + b.originalPos * v + c.originalPos * u;
+      for (int lane = 0; lane < 4; ++lane) {
+        if (!covered[lane])
+          continue;
 
-      fragments.push_back(
-        Fragment{
-          static_cast<uint16_t>(P.x),
-          static_cast<uint16_t>(P.y),
-          z,
-          color,
-          intensity,
-          worldPos,
-          originalPos
-        }
-      );
+        float z = A.z * w[lane] + B.z * v[lane] + C.z * u[lane];
+
+        glm::vec3 normal = glm::normalize(
+            normalA * w[lane] + normalB * v[lane] + normalC * u[lane]
+        );
+
+        // glm::vec3 normal = a.normal; // assume flatness
+        float intensity = glm::dot(normal, L);
+
+        if (intensity < 0)
+          continue;
+
+        Color color = Color(255, 255, 255);
+
+        glm::vec3 originalPos = needsPosition
+            ? a.originalPos * w[lane] + b.originalPos * v[lane] + c.originalPos * u[lane]
+            : glm::vec3(0.0f);
+
+        fragments.push_back(
+          Fragment{
+            static_cast<uint16_t>(qx + (lane & 1)),
+            static_cast<uint16_t>(qy + (lane >> 1)),
+            z,
+            color,
+            intensity,
+            uv[lane],
+            footprint,
+            originalPos
+          }
+        );
+      }
     }
+  }
 }
+
+std::vector<Fragment> triangle(const Vertex& a, const Vertex& b, const Vertex& c, bool needsPosition = true) {
+  std::vector<Fragment> fragments;
+  triangle(a, b, c, needsPosition, fragments);
   return fragments;
 }
\ No newline at end of file
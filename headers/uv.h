@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+// Equirectangular UV for a point on the unit sphere, same mapping the planet shaders used per fragment
+glm::vec2 sphericalUV(const glm::vec3 &position)
+{
+    glm::vec3 pos = glm::normalize(position);
+    float u = 0.5f + atan2(pos.z, pos.x) / (2.0f * glm::pi<float>());
+    float v = 0.5f - asin(pos.y) / glm::pi<float>();
+    return glm::vec2(u, v);
+}
+
+// Computes the UVs of one triangle so they interpolate correctly across the longitude seam and the poles.
+// center is the sphere center in object space, meshes are not always modelled around the origin.
+std::array<glm::vec2, 3> triangleUV(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, const glm::vec3 &center = glm::vec3(0.0f))
+{
+    std::array<glm::vec3, 3> pos = {glm::normalize(a - center), glm::normalize(b - center), glm::normalize(c - center)};
+    std::array<glm::vec2, 3> uv = {sphericalUV(pos[0]), sphericalUV(pos[1]), sphericalUV(pos[2])};
+
+    // Longitude is undefined at a pole: a corner much closer to the axis than the other two is one,
+    // whatever its exact latitude (a pole corner never shares a triangle with another pole corner)
+    int pole = -1;
+    std::array<float, 3> axisDistance;
+    for (int i = 0; i < 3; ++i)
+    {
+        axisDistance[i] = glm::length(glm::vec2(pos[i].x, pos[i].z));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        float others = std::min(axisDistance[(i + 1) % 3], axisDistance[(i + 2) % 3]);
+        if (axisDistance[i] < 1e-4f || axisDistance[i] < 0.1f * others)
+        {
+            pole = i;
+        }
+    }
+
+    // A triangle spanning more than half a turn crosses the seam: unwrap the low side past 1
+    // so the rasterizer interpolates the short way round (shaders wrap u back with fract)
+    float minU = 1.0f;
+    float maxU = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (i != pole)
+        {
+            minU = std::min(minU, uv[i].x);
+            maxU = std::max(maxU, uv[i].x);
+        }
+    }
+    if (maxU - minU > 0.5f)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (i != pole && uv[i].x < 0.5f)
+            {
+                uv[i].x += 1.0f;
+            }
+        }
+    }
+
+    // The pole takes the longitude of the other two corners
+    if (pole >= 0)
+    {
+        uv[pole].x = 0.5f * (uv[(pole + 1) % 3].x + uv[(pole + 2) % 3].x);
+    }
+
+    return uv;
+}
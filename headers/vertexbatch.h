@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "fragment.h"
+#include "simd.h"
+#include "uniforms.h"
+
+constexpr size_t VERTEX_BATCH = 8; // Vertices per SIMD batch, one AVX2 register of floats
+
+// Mesh attributes as structure-of-arrays, padded to a whole number of batches
+struct VertexStream
+{
+    size_t count = 0;
+    std::vector<float> px, py, pz;
+    std::vector<float> nx, ny, nz;
+    std::vector<float> u, v;
+};
+
+// Splits an interleaved VBO (position, normal, tex triples) into a VertexStream
+VertexStream makeVertexStream(const std::vector<glm::vec3> &vertexBufferObject)
+{
+    VertexStream stream;
+    stream.count = vertexBufferObject.size() / 3;
+    size_t padded = (stream.count + VERTEX_BATCH - 1) / VERTEX_BATCH * VERTEX_BATCH;
+
+    for (auto *attribute : {&stream.px, &stream.py, &stream.pz, &stream.nx, &stream.ny, &stream.nz, &stream.u, &stream.v})
+    {
+        attribute->assign(padded, 0.0f);
+    }
+    // Padding lanes get a unit normal so normalizing them stays finite
+    std::fill(stream.nz.begin() + stream.count, stream.nz.end(), 1.0f);
+
+    for (size_t i = 0; i < stream.count; ++i)
+    {
+        const glm::vec3 &position = vertexBufferObject[3 * i];
+        const glm::vec3 &normal = vertexBufferObject[3 * i + 1];
+        const glm::vec3 &tex = vertexBufferObject[3 * i + 2];
+        stream.px[i] = position.x;
+        stream.py[i] = position.y;
+        stream.pz[i] = position.z;
+        stream.nx[i] = normal.x;
+        stream.ny[i] = normal.y;
+        stream.nz[i] = normal.z;
+        stream.u[i] = tex.x;
+        stream.v[i] = tex.y;
+    }
+
+    return stream;
+}
+
+// Matrices combined once per model per frame instead of once per vertex
+struct VertexTransform
+{
+    glm::mat4 screen; // viewport * projection * view * model, the divide by w happens after
+    glm::mat3 normal; // Same normal transform as vertexShader()
+};
+
+VertexTransform makeVertexTransform(const Uniforms &uniforms)
+{
+    // The viewport matrix is affine, so it commutes with the perspective divide
+    return VertexTransform{
+        uniforms.viewport * uniforms.projection * uniforms.view * uniforms.model,
+        glm::mat3(uniforms.model)};
+}
+
+// Transforms the batch of VERTEX_BATCH vertices starting at base into screen positions (s) and unit normals (t)
+void transformBatch(const VertexStream &stream, size_t base, const glm::mat4 &m, const glm::mat3 &n,
+                    float *sx, float *sy, float *sz, float *tx, float *ty, float *tz)
+{
+    // Same math lane by lane, simple enough for the compiler to vectorize
+    for (size_t lane = 0; lane < VERTEX_BATCH; ++lane)
+    {
+        size_t i = base + lane;
+        float x = stream.px[i], y = stream.py[i], z = stream.pz[i];
+        float invW = 1.0f / (m[0][3] * x + m[1][3] * y + m[2][3] * z + m[3][3]);
+        sx[lane] = (m[0][0] * x + m[1][0] * y + m[2][0] * z + m[3][0]) * invW;
+        sy[lane] = (m[0][1] * x + m[1][1] * y + m[2][1] * z + m[3][1]) * invW;
+        sz[lane] = (m[0][2] * x + m[1][2] * y + m[2][2] * z + m[3][2]) * invW;
+
+        float nx = stream.nx[i], ny = stream.ny[i], nz = stream.nz[i];
+        float ox = n[0][0] * nx + n[1][0] * ny + n[2][0] * nz;
+        float oy = n[0][1] * nx + n[1][1] * ny + n[2][1] * nz;
+        float oz = n[0][2] * nx + n[1][2] * ny + n[2][2] * nz;
+        float length = std::sqrt(ox * ox + oy * oy + oz * oz);
+        tx[lane] = ox / length;
+        ty[lane] = oy / length;
+        tz[lane] = oz / length;
+    }
+}
+
+#if SIMD_AVX2
+// a * x + b * y + c * z for eight lanes
+AVX2_TARGET static inline __m256 dot3Avx2(float a, float b, float c, __m256 x, __m256 y, __m256 z)
+{
+    __m256 acc = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a), x), _mm256_mul_ps(_mm256_set1_ps(b), y));
+    return _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(c), z));
+}
+
+// AVX2 version of transformBatch(), the outputs must be 32-byte aligned
+AVX2_TARGET void transformBatchAvx2(const VertexStream &stream, size_t base, const glm::mat4 &m, const glm::mat3 &n,
+                                    float *sx, float *sy, float *sz, float *tx, float *ty, float *tz)
+{
+    __m256 x = _mm256_loadu_ps(&stream.px[base]);
+    __m256 y = _mm256_loadu_ps(&stream.py[base]);
+    __m256 z = _mm256_loadu_ps(&stream.pz[base]);
+
+    // Row r of M * (x, y, z, 1), glm matrices are column-major
+    __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(dot3Avx2(m[0][3], m[1][3], m[2][3], x, y, z), _mm256_set1_ps(m[3][3])));
+    _mm256_store_ps(sx, _mm256_mul_ps(_mm256_add_ps(dot3Avx2(m[0][0], m[1][0], m[2][0], x, y, z), _mm256_set1_ps(m[3][0])), invW));
+    _mm256_store_ps(sy, _mm256_mul_ps(_mm256_add_ps(dot3Avx2(m[0][1], m[1][1], m[2][1], x, y, z), _mm256_set1_ps(m[3][1])), invW));
+    _mm256_store_ps(sz, _mm256_mul_ps(_mm256_add_ps(dot3Avx2(m[0][2], m[1][2], m[2][2], x, y, z), _mm256_set1_ps(m[3][2])), invW));
+
+    __m256 nx = _mm256_loadu_ps(&stream.nx[base]);
+    __m256 ny = _mm256_loadu_ps(&stream.ny[base]);
+    __m256 nz = _mm256_loadu_ps(&stream.nz[base]);
+    __m256 ox = dot3Avx2(n[0][0], n[1][0], n[2][0], nx, ny, nz);
+    __m256 oy = dot3Avx2(n[0][1], n[1][1], n[2][1], nx, ny, nz);
+    __m256 oz = dot3Avx2(n[0][2], n[1][2], n[2][2], nx, ny, nz);
+    __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)), _mm256_mul_ps(oz, oz)));
+    _mm256_store_ps(tx, _mm256_div_ps(ox, length));
+    _mm256_store_ps(ty, _mm256_div_ps(oy, length));
+    _mm256_store_ps(tz, _mm256_div_ps(oz, length));
+}
+#endif
+
+// Batched equivalent of calling vertexShader() on every vertex of the stream
+void transformVertices(const VertexStream &stream, const VertexTransform &transform, std::vector<Vertex> &out)
+{
+    out.resize(stream.count);
+    const glm::mat4 &m = transform.screen;
+    const glm::mat3 &n = transform.normal;
+
+    alignas(32) float sx[VERTEX_BATCH], sy[VERTEX_BATCH], sz[VERTEX_BATCH];
+    alignas(32) float tx[VERTEX_BATCH], ty[VERTEX_BATCH], tz[VERTEX_BATCH];
+
+    for (size_t base = 0; base < stream.count; base += VERTEX_BATCH)
+    {
+#if SIMD_AVX2
+        if (hasAvx2())
+        {
+            transformBatchAvx2(stream, base, m, n, sx, sy, sz, tx, ty, tz);
+        }
+        else
+#endif
+        {
+            transformBatch(stream, base, m, n, sx, sy, sz, tx, ty, tz);
+        }
+
+        size_t end = std::min(base + VERTEX_BATCH, stream.count);
+        for (size_t i = base; i < end; ++i)
+        {
+            size_t lane = i - base;
+            out[i] = Vertex{
+                glm::vec3(sx[lane], sy[lane], sz[lane]),
+                packNormal(glm::vec3(tx[lane], ty[lane], tz[lane])),
+                glm::vec2(stream.u[i], stream.v[i]),
+                glm::vec3(stream.px[i], stream.py[i], stream.pz[i])};
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// Global operator new / delete replacements counting allocations per thread, see headers/alloctracker.h.
+// Built only with -DENABLE_ALLOCATION_TRACKING=ON; over-aligned allocations keep the default operators.
+#ifdef TRACK_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "../headers/alloctracker.h"
+
+namespace
+{
+    // Every block starts with its size so delete knows how much to subtract
+    constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+    void *trackedAllocate(size_t size)
+    {
+        void *block = std::malloc(size + HEADER_SIZE);
+        if (!block)
+        {
+            return nullptr;
+        }
+        *static_cast<size_t *>(block) = size;
+
+        AllocationCounters &counters = threadAllocations;
+        ++counters.allocations;
+        counters.bytes += size;
+        counters.liveBytes += static_cast<int64_t>(size);
+        counters.peakLiveBytes = std::max(counters.peakLiveBytes, counters.liveBytes);
+
+        return static_cast<char *>(block) + HEADER_SIZE;
+    }
+
+    void trackedFree(void *pointer)
+    {
+        if (!pointer)
+        {
+            return;
+        }
+        void *block = static_cast<char *>(pointer) - HEADER_SIZE;
+
+        AllocationCounters &counters = threadAllocations;
+        ++counters.frees;
+        counters.liveBytes -= static_cast<int64_t>(*static_cast<size_t *>(block));
+
+        std::free(block);
+    }
+
+    void *allocateOrThrow(size_t size)
+    {
+        void *pointer = trackedAllocate(size);
+        if (!pointer)
+        {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+}
+
+void *operator new(size_t size) { return allocateOrThrow(size); }
+void *operator new[](size_t size) { return allocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return trackedAllocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return trackedAllocate(size); }
+
+void operator delete(void *pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void *pointer) noexcept { trackedFree(pointer); }
+void operator delete(void *pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { trackedFree(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { trackedFree(pointer); }
+
+#endif
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <vector>
 #include <cassert>
+#include <filesystem>
+#include <iomanip>
 
 // Headers de las clases Necesarias
 #include "../headers/uniforms.h"
@@ -20,22 +22,56 @@
 #include "../headers/color.h"
 #include "../headers/print.h"
 #include "../headers/framebuffer.h"
+#include "../headers/uv.h"
+#include "../headers/footprint.h"
+#include "../headers/texturecache.h"
+#include "../headers/mesh.h"
+#include "../headers/orbits.h"
+#include "../headers/hierarchy.h"
+#include "../headers/spatialgrid.h"
+#include "../headers/bvh.h"
+#include "../headers/scene.h"
+#include "../headers/hiz.h"
+#include "../headers/simclock.h"
+#include "../headers/options.h"
+#include "../headers/camerapath.h"
+#include "../headers/capture.h"
+#include "../headers/stars.h"
+#include "../headers/profiler.h"
+#include "../headers/trace.h"
+#include "../headers/input.h"
+#include "../headers/debugview.h"
 
 SDL_Window *window = nullptr;
 SDL_Renderer *renderer = nullptr;
 Color currentColor;
 
-std::vector<Model> models;
+Scene scene;
+DepthPyramid depthPyramid;
+FrameExporter frameExporter;
 Uniforms uniforms;
 
-bool init()
+uint64_t rasterizedFragments = 0; // Over the whole run, for the fly-through report
+
+// Hardware counters of the fragment stage, only filled with --perf-counters
+std::array<CounterTotals, SHADER_TYPE_COUNT> shaderCounters;
+CounterTotals virtualTextureCounters;
+
+// headless: only the timer is initialized, frames stay in the framebuffer
+bool init(bool headless)
 {
-    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    if (SDL_Init(headless ? SDL_INIT_TIMER : SDL_INIT_VIDEO) != 0)
     {
         std::cerr << "Error: Failed to initialize SDL: " << SDL_GetError() << std::endl;
         return false;
     }
 
+    if (headless)
+    {
+        setupNoise();
+        return true;
+    }
+
     window = SDL_CreateWindow("Software Renderer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     if (!window)
     {
@@ -60,18 +96,32 @@ void setColor(const Color &color)
     currentColor = color;
 }
 
-void render()
+// Only these shaders read the interpolated object-space position, the cache bakes its own
+bool needsOriginalPos(const Model &model)
+{
+    return model.texturePlanet < 0 && (model.currentShader == NEPTUNE || model.currentShader == STAR);
+}
+
+// alpha: fraction of a simulation step since the latest one, see SimulationClock
+// modelIndex: position in scene.models, for the model id debug view
+void renderModel(const Model &model, int modelIndex, float alpha)
 {
-    for (const auto &model : models)
+    TraceScope modelTrace("model", "job", model.node);
+
+    // 1. Vertex Shader
+    std::vector<Vertex> transformedVertices;
     {
-        // 1. Vertex Shader
-        uniforms.model = model.modelMatrix;
-        std::vector<Vertex> transformedVertices(model.vertices.size() / 3);
-        for (size_t i = 0; i < model.vertices.size() / 3; ++i)
-        {
-            Vertex vertex = {model.vertices[3 * i], model.vertices[3 * i + 1], model.vertices[3 * i + 2]};
-            transformedVertices[i] = vertexShader(vertex, uniforms);
-        }
+        StageTimer vertexTimer(STAGE_VERTEX);
+        uniforms.model = scene.transforms.interpolated(model.node, alpha);
+        transformVertices(model.mesh->stream, makeVertexTransform(uniforms), transformedVertices);
+    }
+
+    // Virtually textured models never read originalPos, they rasterize into a structure-of-arrays batch
+    bool textured = model.texturePlanet >= 0;
+    std::vector<Fragment> fragments;
+    FragmentBatch batch;
+    {
+        StageTimer rasterTimer(STAGE_RASTER);
 
         // 2. Primitive Assembly
         std::vector<std::vector<Vertex>> assembledVertices(transformedVertices.size() / 3);
@@ -84,113 +134,119 @@ void render()
         }
 
         // 3. Rasterization
-        std::vector<Fragment> fragments;
+        bool needsPosition = needsOriginalPos(model);
 
         for (size_t i = 0; i < assembledVertices.size(); ++i)
         {
-            std::vector<Fragment> rasterizedTriangle = triangle(
-                assembledVertices[i][0],
-                assembledVertices[i][1],
-                assembledVertices[i][2]);
-            fragments.insert(fragments.end(), rasterizedTriangle.begin(), rasterizedTriangle.end());
-        }
-
-        // 4. Fragment Shader
-        for (size_t i = 0; i < fragments.size(); ++i)
-        {
-            Fragment (*fragmentShader)(Fragment &) = nullptr;
-
-            switch (model.currentShader)
+            if (textured)
             {
-            case ROCKY:
-                fragmentShader = rockyPlanetShader;
-                break;
-            case GAS:
-                fragmentShader = gasGiantShader;
-                break;
-            case SUN:
-                fragmentShader = sunShader;
-                break;
-            case EARTH:
-                fragmentShader = earthShader;
-                break;
-            case MARS:
-                fragmentShader = marsShader;
-                break;
-            case NEPTUNE:
-                fragmentShader = neptuneShader;
-                break;
-            case STAR:
-                fragmentShader = starShader;
-                break;
-            default:
-                std::cerr << "Error: Shader no reconocido." << std::endl;
-                break;
+                triangle(assembledVertices[i][0], assembledVertices[i][1], assembledVertices[i][2], false, batch);
+            }
+            else
+            {
+                triangle(assembledVertices[i][0], assembledVertices[i][1], assembledVertices[i][2], needsPosition, fragments);
             }
-            const Fragment &fragment = fragmentShader(fragments[i]);
-
-            point(fragment);
         }
+        rasterizedFragments += textured ? batch.size() : fragments.size();
     }
-}
 
-void renderStars(int ox, int oy)
-{
-    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    // 4. Fragment Shader
+    StageTimer shadeTimer(STAGE_SHADE);
+    FragmentShader fragmentShader = selectShader(model.currentShader);
+    if (!fragmentShader)
     {
-        for (int x = 0; x < SCREEN_WIDTH; x++)
-        {
-            FastNoiseLite noiseGenerator;
-            noiseGenerator.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+        return;
+    }
+
+    bool counting = profiler.counters.isOpen();
+    bool debugging = debugBuffers.active();
+    CounterSample shadeStart = counting ? profiler.counters.read() : CounterSample();
 
-            float scale = 1000.0f;
-            float noiseValue = noiseGenerator.GetNoise((x + (ox * 100.0f)) * scale, (y + oy * 100.0f) * scale);
+    if (textured)
+    {
+        // Cached surface from the virtual texture, relit with the interpolated intensity
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            uint64_t cycles = debugging ? readCycles() : 0;
+            int mip = selectMip(batch.footprint[i]);
+            Color shaded = virtualTexture.sample(model.texturePlanet, mip, glm::vec2(batch.u[i], batch.v[i])) * batch.intensity[i];
+            shaded.a = 255;
+            batch.color[i] = shaded;
 
-            // If the noise value is above a threshold, draw a star
-            if (noiseValue > 0.97f)
+            if (debugging)
             {
-                framebuffer[y * SCREEN_WIDTH + x] = star;
+                cycles = readCycles() - cycles;
             }
-            else
+            Fragment fragment = batch[i];
+            bool written = point(fragment);
+            if (debugging)
             {
-                framebuffer[y * SCREEN_WIDTH + x] = blank;
+                debugBuffers.record(fragment, modelIndex, cycles, written);
             }
         }
+        if (counting)
+        {
+            virtualTextureCounters.add(profiler.counters.read() - shadeStart, batch.size());
+        }
+        return;
     }
-}
 
-std::vector<glm::vec3> createVBO(std::string path)
-{
+    for (size_t i = 0; i < fragments.size(); ++i)
+    {
+        uint64_t cycles = debugging ? readCycles() : 0;
+        const Fragment &fragment = fragmentShader(fragments[i]);
 
-    std::vector<glm::vec3> vertices;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec3> texCoords;
-    std::vector<Face> faces;
-    std::vector<glm::vec3> vertexBufferObject; // This will contain both vertices and normals
+        if (debugging)
+        {
+            cycles = readCycles() - cycles;
+        }
+        bool written = point(fragment);
+        if (debugging)
+        {
+            debugBuffers.record(fragment, modelIndex, cycles, written);
+        }
+    }
+    if (counting)
+    {
+        shaderCounters[model.currentShader].add(profiler.counters.read() - shadeStart, fragments.size());
+    }
+}
 
-    loadOBJ(path.c_str(), vertices, normals, texCoords, faces);
+// Returns how many models were skipped as occluded
+int render(float alpha)
+{
+    // Descarta los modelos fuera de la cámara antes del vertex shader
+    std::vector<int> visibleModels;
+    scene.bvh.cull(makeFrustum(uniforms.projection * uniforms.view), visibleModels);
 
-    for (const auto &face : faces)
+    // Los modelos grandes en pantalla se dibujan primero y sirven de oclusores
+    std::vector<int> occludees;
+    for (int index : visibleModels)
     {
-        for (int i = 0; i < 3; ++i)
+        const glm::vec4 &bounds = scene.bounds[index];
+        if (bounds.w < 0.0f || projectedRadius(bounds, uniforms) >= HIZ_OCCLUDER_RADIUS)
         {
-            // Get the vertex position
-            glm::vec3 vertexPosition = vertices[face.vertexIndices[i]];
-
-            // Get the normal for the current vertex
-            glm::vec3 vertexNormal = normals[face.normalIndices[i]];
-
-            // Get the texture for the current vertex
-            glm::vec3 vertexTexture = texCoords[face.texIndices[i]];
-
-            // Add the vertex position and normal to the vertex array
-            vertexBufferObject.push_back(vertexPosition);
-            vertexBufferObject.push_back(vertexNormal);
-            vertexBufferObject.push_back(vertexTexture);
+            renderModel(scene.models[index], index, alpha);
+        }
+        else
+        {
+            occludees.push_back(index);
         }
     }
 
-    return vertexBufferObject;
+    // El resto se prueba contra la pirámide de profundidad antes de transformarlo
+    int occluded = 0;
+    depthPyramid.build();
+    for (int index : occludees)
+    {
+        if (depthPyramid.occluded(scene.bounds[index], uniforms))
+        {
+            ++occluded;
+            continue;
+        }
+        renderModel(scene.models[index], index, alpha);
+    }
+    return occluded;
 }
 
 glm::mat4 createViewportMatrix(size_t screenWidth, size_t screenHeight)
@@ -209,28 +265,17 @@ glm::mat4 createViewportMatrix(size_t screenWidth, size_t screenHeight)
 int main(int argc, char *argv[])
 {
 
-    ShaderType currentShader = ROCKY;
-
-    if (!init())
+    // Escena, modo sin ventana y ruta de cámara desde la línea de comandos, ver options.h
+    Options options;
+    if (!parseOptions(argc, argv, options))
     {
         return 1;
     }
 
-    std::vector<glm::vec3> vertexBufferObject = createVBO("../models/sphere.obj");
-    std::vector<glm::vec3> vBoSpaceship = createVBO("../models/nave.obj");
-
-    glm::mat4 model = glm::mat4(1);
-    glm::mat4 view = glm::mat4(1);
-    glm::mat4 projection = glm::mat4(1);
-
-    glm::vec3 translationVector(0.0f, 0.0f, 0.0f);
-    // float a = 45.0f;
-    glm::vec3 rotationAxis(0.0f, 1.0f, 0.0f); // Rotate around the Y-axis
-    glm::vec3 scaleFactor(1.0f, 1.0f, 1.0f);
-
-    glm::mat4 translation = glm::translate(glm::mat4(1.0f), translationVector);
-
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), scaleFactor);
+    if (!init(options.headless))
+    {
+        return 1;
+    }
 
     // Initialize a Camera object
     Camera camera;
@@ -247,96 +292,104 @@ int main(int argc, char *argv[])
 
     // Viewport matrix
     uniforms.viewport = createViewportMatrix(SCREEN_WIDTH, SCREEN_HEIGHT);
-    Uint32 frameStart, frameTime;
     std::string title = "FPS: ";
     float speed = 0.5f;
 
     bool running = true;
-    // Model 1
-    Model model1;
-    model1.modelMatrix = glm::mat4(1);
-    model1.vertices = vertexBufferObject;
-    model1.rotationSpeed = 1.0f;
-    model1.currentShader = SUN;
-    models.push_back(model1); // Add model1 to models vector
-
-    // Model 2:
-    Model model2;
-    model2.modelMatrix = glm::mat4(1);
-    model2.vertices = vertexBufferObject;
-    model2.degreesRotation = 45.0f; // grados de mi rotación
-    model2.radius = 1.5f;           // radio de alejamiennto a sol
-    model2.currentShader = ROCKY;
-    model2.rotationSpeed = 20.0f;
-    model2.translationSpeed = 0.001f; // velocidad de traslación
-    models.push_back(model2);         // Add model2 to models vector
-
-    // Model 3:
-    Model model3;
-    model3.modelMatrix = glm::mat4(1);
-    model3.vertices = vertexBufferObject;
-    model3.degreesRotation = 10.0f;   // grados de mi rotación
-    model3.radius = 1.2f;             // radio de alejamiennto a sol
-    model3.translationSpeed = 0.005f; // velocidad de traslación
-    model3.currentShader = GAS;
-    model3.rotationSpeed = 2.0f;
-    models.push_back(model3); // Add model3 to models vector
-
-    // Model 4:
-    Model model4;
-    model4.modelMatrix = glm::mat4(1);
-    model4.vertices = vertexBufferObject;
-    model4.currentShader = EARTH;
-    model4.degreesRotation = 15.0f;   // grados de mi rotación
-    model4.radius = 0.9f;             // radio de alejamiennto a sol
-    model4.translationSpeed = 0.009f; // velocidad de traslación
-    model4.rotationSpeed = 2.0f;
-    models.push_back(model4); // Add model3 to models vector
-
-    // Model 5:
-    Model model5;
-    model5.modelMatrix = glm::mat4(1);
-    model5.vertices = vertexBufferObject;
-    model5.currentShader = STAR;
-    model5.rotationSpeed = 8.0f;
-    model5.degreesRotation = 25.0f;   // grados de mi rotación
-    model5.radius = 1.4f;             // radio de alejamiennto a sol
-    model5.translationSpeed = 0.009f; // velocidad de traslación
-    models.push_back(model5);         // Add model3 to models vector
-
-    Model model6;
-    model6.modelMatrix = glm::mat4(1);
-    model6.vertices = vertexBufferObject;
-    model6.currentShader = MARS;
-    model6.rotationSpeed = 3.0f;
-    model6.degreesRotation = 20.0f;   // grados de mi rotación
-    model6.radius = 1.6f;             // radio de alejamiennto a sol
-    model6.translationSpeed = 0.009f; // velocidad de traslación
-    models.push_back(model6);         // Add model3 to models vector
-
-    Model model7;
-    model7.modelMatrix = glm::mat4(1);
-    model7.vertices = vertexBufferObject;
-    model7.currentShader = NEPTUNE;
-    model7.rotationSpeed = 3.0f;
-    model7.degrees = 45.0f;
-    model7.degreesRotation = 0.0f;    // grados de mi rotación
-    model7.radius = 0.9f;             // radio de alejamiennto a sol
-    model7.translationSpeed = 0.009f; // velocidad de traslación
-    models.push_back(model7);         // Add model3 to models vector
-
-    Model nave;
-    nave.modelMatrix = glm::mat4(100);
-    nave.vertices = vBoSpaceship;
-    nave.currentShader = ROCKY;
-    models.push_back(nave); // Add model3 to models vector
+    bool showHud = options.hud;
+    debugBuffers.view = options.debugView;
+
+    if (!loadScene(options.scenePath, scene))
+    {
+        return 1;
+    }
+
+    CameraPath cameraPath;
+    if (!options.cameraPath.empty() && !loadCameraPath(options.cameraPath, cameraPath))
+    {
+        return 1;
+    }
+
+    // La línea de tiempo empieza antes de los hilos de texturas y de captura para incluirlos
+    if (!options.tracePath.empty())
+    {
+        tracer.enable();
+        tracer.nameThread("main");
+    }
+
+    if (options.perfCounters)
+    {
+        profiler.enableCounters();
+    }
+
+    if (!options.profileCsv.empty() && !profiler.openCsv(options.profileCsv))
+    {
+        std::cerr << "Error: Failed to open " << options.profileCsv << std::endl;
+        return 1;
+    }
+
+    if (!options.outputDir.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(options.outputDir, error);
+        if (error)
+        {
+            std::cerr << "Error: Failed to create " << options.outputDir << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    // Los frames se escriben en otro hilo, el render nunca espera al disco
+    bool capturing = !options.outputDir.empty() || !options.videoPath.empty();
+    int captureFps = static_cast<int>(1.0f / SIMULATION_STEP + 0.5f);
+    if (!options.outputDir.empty() && !frameExporter.start(options.outputDir, CAPTURE_PPM, captureFps))
+    {
+        return 1;
+    }
+    if (!options.videoPath.empty() && !frameExporter.start(options.videoPath, CAPTURE_Y4M, captureFps))
+    {
+        std::cerr << "Error: Failed to open " << options.videoPath << std::endl;
+        return 1;
+    }
+
+    InputReplay inputReplay;
+    bool replaying = !options.replayInput.empty();
+    if (replaying && !inputReplay.load(options.replayInput))
+    {
+        return 1;
+    }
+
+    InputRecorder inputRecorder;
+    if (!options.recordInput.empty() && !inputRecorder.open(options.recordInput))
+    {
+        std::cerr << "Error: Failed to open " << options.recordInput << std::endl;
+        return 1;
+    }
+
+    // Sin ventana, al grabar o reproducir, o con ruta de cámara se avanza un paso por frame para que la corrida sea reproducible.
+    // La grabación también, así la reproducción da los mismos pasos de simulación por frame
+    bool fixedStep = options.headless || replaying || !options.recordInput.empty() || !cameraPath.empty();
+
+    // Stream finer virtual texture tiles in the background while rendering
+    if (options.textureBudget > 0)
+    {
+        virtualTexture.memoryBudget = static_cast<size_t>(options.textureBudget) * 1024 * 1024;
+    }
+    virtualTexture.start();
+
+    SimulationClock simulationClock;
+    Uint32 runStart = SDL_GetTicks();
+    int frame = 0;
 
     while (running)
     {
-        frameStart = SDL_GetTicks();
+        TraceScope frameTrace("frame", "frame", frame);
+        profiler.beginFrame();
 
-        // Calculate the model matrix
-        uniforms.model = translation * scale;
+        if (!cameraPath.empty())
+        {
+            cameraPath.apply(frame, camera);
+        }
 
         // Create the view matrix using the Camera object
         uniforms.view = glm::lookAt(
@@ -345,63 +398,57 @@ int main(int argc, char *argv[])
             camera.upVector        // The up vector defining the camera's orientation
         );
 
-        // actualización de los modelos
-        models.at(0).modelMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(model1.degrees += model1.rotationSpeed), rotationAxis);
-        models.at(1).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(1).radius * glm::cos(models.at(1).degreesRotation),
-                                                            0.0f,
-                                                            models.at(1).radius * glm::sin(models.at(1).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model2.degrees += model2.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.2f, 0.2f, 0.2f));
-        models.at(1).degreesRotation += model2.translationSpeed;
-
-        models.at(2).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(2).radius * glm::cos(models.at(2).degreesRotation),
-                                                            0.0f,
-                                                            models.at(2).radius * glm::sin(models.at(2).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model3.degrees += model3.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.2f, 0.2f, 0.2f));
-        models.at(2).degreesRotation += model3.translationSpeed;
-
-        models.at(3).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(3).radius * glm::cos(models.at(3).degreesRotation),
-                                                            0.0f,
-                                                            models.at(3).radius * glm::sin(models.at(3).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model4.degrees += model4.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.2f, 0.2f, 0.2f));
-        models.at(3).degreesRotation += model4.translationSpeed;
-
-        models.at(4).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(4).radius * glm::cos(models.at(4).degreesRotation),
-                                                            0.0f,
-                                                            models.at(4).radius * glm::sin(models.at(4).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model5.degrees += model5.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.1f, 0.1f, 0.1f));
-        models.at(4).degreesRotation += model5.translationSpeed;
-
-        models.at(5).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(5).radius * glm::cos(models.at(5).degreesRotation),
-                                                            0.0f,
-                                                            models.at(5).radius * glm::sin(models.at(5).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model6.degrees += model6.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.3f, 0.3f, 0.3f));
-        models.at(5).degreesRotation += model6.translationSpeed;
-
-        models.at(6).modelMatrix = glm::translate(glm::mat4(1.0f),
-                                                  glm::vec3(models.at(6).radius * glm::cos(models.at(6).degreesRotation),
-                                                            0.0f,
-                                                            models.at(6).radius * glm::sin(models.at(6).degreesRotation))) *
-                                   glm::rotate(glm::mat4(1.0f), glm::radians(model7.degrees += model7.rotationSpeed), rotationAxis) * glm::scale(glm::mat4(1.0f), glm::vec3(0.2f, 0.2f, 0.2f));
-        models.at(6).degreesRotation += model7.translationSpeed;
-
-        models.at(7).modelMatrix = glm::translate(glm::mat4(1), glm::vec3(camera.cameraPosition.x, camera.cameraPosition.y, 1.5f)) * glm::scale(glm::mat4(1), glm::vec3(0.01f, 0.01f, 0.01f));
-
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
+        // actualización de los modelos, a paso fijo independiente de los FPS
         {
-            if (event.type == SDL_QUIT)
+            StageTimer simulationTimer(STAGE_SIMULATION);
+            int steps = fixedStep ? 1 : simulationClock.advance();
+            for (int step = 0; step < steps; ++step)
+            {
+                updateScene(scene, camera);
+            }
+        }
+
+        StageTimer eventsTimer(STAGE_EVENTS);
+        glm::vec3 previousPosition = camera.cameraPosition;
+        glm::vec3 previousTarget = camera.targetPosition;
+
+        // Con una grabación se ignora el teclado, solo se atiende el cierre de la ventana
+        std::vector<InputEvent> inputs;
+        if (replaying)
+        {
+            std::vector<InputEvent> live;
+            if (!options.headless)
+            {
+                pollInput(frame, live);
+            }
+            for (const InputEvent &input : live)
+            {
+                running = running && input.type != INPUT_QUIT;
+            }
+            inputReplay.eventsAt(frame, inputs);
+
+            // Sin línea final de quit la grabación termina igual cuando se agotan sus eventos
+            running = running && !inputReplay.finished();
+        }
+        else if (!options.headless)
+        {
+            pollInput(frame, inputs);
+        }
+        if (inputRecorder.isOpen())
+        {
+            inputRecorder.record(inputs);
+        }
+
+        for (const InputEvent &input : inputs)
+        {
+            if (input.type == INPUT_QUIT)
             {
                 running = false;
             }
 
-            if (event.type == SDL_KEYDOWN)
+            if (input.type == INPUT_KEY)
             {
-                switch (event.key.keysym.sym)
+                switch (input.value)
                 {
                 case SDLK_LEFT:
                     camera.cameraPosition.x -= speed;
@@ -435,16 +482,22 @@ int main(int argc, char *argv[])
                     // Si 'd' es para mover la cámara lateralmente
                     camera.cameraPosition.x += speed;
                     break;
+                case SDLK_h:
+                    showHud = !showHud;
+                    break;
+                case SDLK_v:
+                    debugBuffers.view = static_cast<DebugView>((debugBuffers.view + 1) % VIEW_COUNT);
+                    break;
                 }
             }
-            else if (event.type == SDL_MOUSEWHEEL)
+            else if (input.type == INPUT_WHEEL)
             {
-                if (event.wheel.y > 0) // rueda se mueve hacia arriba
+                if (input.value > 0) // rueda se mueve hacia arriba
                 {
                     // Zoom in
                     camera.cameraPosition.z -= speed * 1; // Ajusta el multiplicador según la sensibilidad deseada
                 }
-                else if (event.wheel.y < 0) // rueda se mueve hacia abajo
+                else if (input.value < 0) // rueda se mueve hacia abajo
                 {
                     // Zoom out
                     camera.cameraPosition.z += speed * 1; // Ajusta el multiplicador según la sensibilidad deseada
@@ -452,29 +505,166 @@ int main(int argc, char *argv[])
             }
         }
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+        // La nave no puede atravesar los planetas, se queda donde estaba
+        if (camera.cameraPosition != previousPosition && cameraBlocked(scene, previousPosition, camera.cameraPosition))
+        {
+            camera.cameraPosition = previousPosition;
+            camera.targetPosition = previousTarget;
+        }
+        eventsTimer.stop();
 
-        // x y y de a donde esta viendo la camara
-        renderStars(camera.cameraPosition.x, camera.cameraPosition.y);
+        {
+            StageTimer starsTimer(STAGE_STARS);
 
-        render();
+            // x y y de a donde esta viendo la camara
+            renderStars(camera.cameraPosition.x, camera.cameraPosition.y);
+        }
 
-        renderBuffer(renderer);
+        debugBuffers.beginFrame();
+        virtualTexture.beginFrame();
+        int occludedModels = render(fixedStep ? 1.0f : simulationClock.alpha());
+        debugBuffers.resolve();
 
-        frameTime = SDL_GetTicks() - frameStart;
+        {
+            StageTimer presentTimer(STAGE_PRESENT);
+
+            // Sin ventana no hay prisa, se espera un buffer libre en vez de perder el frame
+            if (capturing)
+            {
+                frameExporter.submit(frame, options.headless);
+            }
+
+            // Gráfica de tiempos por etapa encima de la escena, después de la captura para no grabarla
+            if (!options.headless)
+            {
+                if (showHud)
+                {
+                    profiler.drawHud();
+                }
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+                SDL_RenderClear(renderer);
+                renderBuffer(renderer);
+            }
+        }
+        profiler.endFrame();
+
+        ++frame;
+        if (options.frames > 0 && frame >= options.frames)
+        {
+            running = false;
+        }
 
         // Calculate frames per second and update window title
-        if (frameTime > 0)
+        if (!options.headless && profiler.last() > 0.0f)
         {
             std::ostringstream titleStream;
-            titleStream << "FPS: " << 1000.0 / frameTime; // Milliseconds to seconds
+            titleStream << std::fixed << std::setprecision(1);
+            titleStream << "FPS: " << 1000.0f / profiler.last(); // Milliseconds to seconds
+            titleStream << " | Frame p50/p95/p99: " << profiler.percentile(50.0f) << "/" << profiler.percentile(95.0f) << "/" << profiler.percentile(99.0f) << " ms";
+            titleStream << " | Nearest body: " << nearestBodyDistance(scene, camera.cameraPosition, farClip);
+            titleStream << " | Occluded: " << occludedModels;
+            if (debugBuffers.active())
+            {
+                const DebugBuffers::Totals &totals = debugBuffers.frame;
+                titleStream << " | View: " << debugViewNames[debugBuffers.view]
+                            << " | Overdraw: " << (totals.pixels ? static_cast<float>(totals.fragments) / totals.pixels : 0.0f)
+                            << " avg, " << totals.maxOverdraw << " max"
+                            << " | Shading: " << totals.cycles / 1000000.0f << " Mcycles"
+                            << " | Models on screen: " << totals.models;
+            }
+            if (ALLOCATION_TRACKING)
+            {
+                const AllocationDelta &allocations = profiler.frameAllocations[STAGE_COUNT];
+                titleStream << " | Allocs: " << allocations.allocations << " (" << allocations.bytes / 1024 << " KiB)";
+            }
+            if (capturing)
+            {
+                titleStream << " | Capture queue: " << frameExporter.queueDepth() << " | Dropped: " << frameExporter.droppedFrames();
+            }
             SDL_SetWindowTitle(window, titleStream.str().c_str());
         }
     }
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    virtualTexture.stop();
+
+    if (inputRecorder.isOpen())
+    {
+        inputRecorder.finish(frame - 1);
+    }
+
+    // Reporte de la corrida reproducible, el benchmark de regresión entre builds
+    if (fixedStep)
+    {
+        Uint32 runTime = SDL_GetTicks() - runStart;
+        std::cout << "Rendered " << frame << " frames in " << runTime << " ms";
+        if (runTime > 0)
+        {
+            std::cout << " (" << 1000.0 * frame / runTime << " FPS)";
+        }
+        std::cout << std::endl;
+        std::cout << "Fragments: " << rasterizedFragments << " | Shaded pixels: " << shadedPixels << std::endl;
+        profiler.printSummary(std::cout);
+    }
+
+    if (ALLOCATION_TRACKING)
+    {
+        profiler.printAllocationSummary(std::cout);
+    }
+
+    if (debugBuffers.run.pixels > 0)
+    {
+        const DebugBuffers::Totals &totals = debugBuffers.run;
+        std::cout << "Debug views: " << totals.fragments << " fragments shaded over " << totals.pixels << " covered pixels ("
+                  << static_cast<double>(totals.fragments) / totals.pixels << " avg overdraw, " << totals.maxOverdraw << " max), "
+                  << totals.cycles << " shading cycles, up to " << totals.models << " models on screen" << std::endl;
+    }
+
+    if (capturing)
+    {
+        frameExporter.stop();
+        std::cout << "Captured " << frameExporter.writtenFrames() << " frames, dropped " << frameExporter.droppedFrames()
+                  << ", failed " << frameExporter.failedFrames() << ", max queue depth " << frameExporter.maxQueueDepth()
+                  << "/" << CAPTURE_RING_SIZE << std::endl;
+    }
+
+    // Contadores por etapa y por shader, los shaders se normalizan por fragmento
+    if (profiler.counters.isOpen())
+    {
+        profiler.printCounterSummary(std::cout);
+        printCounterHeader(std::cout, "fragments");
+        for (int shader = 0; shader < SHADER_TYPE_COUNT; ++shader)
+        {
+            if (shaderCounters[shader].samples > 0)
+            {
+                printCounterRow(std::cout, shaderNames[shader], shaderCounters[shader]);
+            }
+        }
+        if (virtualTextureCounters.samples > 0)
+        {
+            printCounterRow(std::cout, "virtualTexture", virtualTextureCounters);
+        }
+    }
+
+    if (!options.tracePath.empty())
+    {
+        if (tracer.write(options.tracePath))
+        {
+            std::cout << "Trace written to " << options.tracePath << ", dropped " << tracer.droppedEvents() << " events" << std::endl;
+        }
+        else
+        {
+            std::cerr << "Error: Failed to write " << options.tracePath << std::endl;
+        }
+    }
+
+    if (renderer)
+    {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window)
+    {
+        SDL_DestroyWindow(window);
+    }
     SDL_Quit();
 
     return 0;
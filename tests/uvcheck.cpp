@@ -0,0 +1,43 @@
+// Checks that the generated sphere UVs have no seam or pole smear: every triangle of models/sphere.obj
+// must cover at most one longitude segment in u
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../headers/mesh.h"
+
+#ifndef CHECK_MODEL_DIR
+#define CHECK_MODEL_DIR "../models"
+#endif
+
+constexpr int SPHERE_SEGMENTS = 32; // Longitude segments of models/sphere.obj
+
+int main()
+{
+    std::vector<glm::vec3> vbo = createVBO(std::string(CHECK_MODEL_DIR) + "/sphere.obj");
+    if (vbo.empty())
+    {
+        std::cerr << "Error: Failed to load " << CHECK_MODEL_DIR << "/sphere.obj" << std::endl;
+        return 1;
+    }
+
+    const float limit = 1.0f / SPHERE_SEGMENTS + 1e-3f;
+    int failures = 0;
+    float widest = 0.0f;
+    for (size_t i = 0; i + 8 < vbo.size(); i += 9)
+    {
+        float u0 = vbo[i + 2].x, u1 = vbo[i + 5].x, u2 = vbo[i + 8].x;
+        float span = std::max(std::max(u0, u1), u2) - std::min(std::min(u0, u1), u2);
+        widest = std::max(widest, span);
+        if (span > limit)
+        {
+            ++failures;
+        }
+    }
+
+    std::cout << vbo.size() / 9 << " triangles, widest u span " << widest << " (limit " << limit << "), "
+              << failures << " over the limit" << std::endl;
+    return failures == 0 ? 0 : 1;
+}